@@ -1,75 +1,88 @@
-
-
-
-#include <opencv.hpp>
-#include <vector>
-
-using namespace cv;
-using namespace std;
-
-
-Vec3f MeanShift(vector<Vec3b> vecVoteColor, vector<float> vecVoteWeight, int sigma)
-{
-	Vec3f vecMean3f = Vec3f{0,0,0};
-
-	float fTotalWeight = 0;
-	for (int i = 0; i < vecVoteColor.size(); i++)
-	{
-		vecMean3f += (Vec3f)(vecVoteColor[i] * vecVoteWeight[i]);
-		fTotalWeight += vecVoteWeight[i];
-	}
-
-	vecMean3f = vecMean3f / fTotalWeight;
-
-	for (int t = 0; t < 5; t++)
-	{
-		float scale = 3 / (1 << t);// 3sigma0.2sigma
-
-		float Thresh = (scale * sigma) * (scale * sigma);
-
-		int nIterNum = 0;
-		while (1)
-		{
-			Vec3f vecCurMean3f = Vec3f{ 0,0,0 };
-			int GroupNum = 0;
-
-			fTotalWeight = 0;
-			for (int i = 0; i < vecVoteColor.size(); i++)
-			{
-				Vec3f Diff = (Vec3f)vecVoteColor[i] - vecMean3f;
-
-				if (Diff[0] * Diff[0] + Diff[1] * Diff[1] + Diff[2] * Diff[2] < Thresh)
-				{
-					vecCurMean3f += vecVoteColor[i] * vecVoteWeight[i];
-
-					fTotalWeight += vecVoteWeight[i];
-
-					GroupNum++;
-				}
-			}
-
-
-			if (GroupNum == 0)
-			{
-				break;
-			}
-			vecCurMean3f = vecCurMean3f / fTotalWeight;
-
-			Vec3f Diff = vecCurMean3f - vecMean3f;
-
-			if (Diff[0] * Diff[0] + Diff[1] * Diff[1] + Diff[2] * Diff[2] < 10)
-			{
-				break;
-			}
-
-			vecMean3f = vecCurMean3f;
-
-			nIterNum++;
-			if (nIterNum > 10)
-				break;
-		}
-	}
-
-	return vecMean3f;
-
-}
\ No newline at end of file
+
+
+
+#include <opencv.hpp>
+#include <vector>
+
+using namespace cv;
+using namespace std;
+
+
+// vecVoteColor holds cn floats per vote. sigma is in pixel units of the
+// image, so 16 bit callers scale it; the step threshold follows it.
+template<int cn>
+Vec<float, cn> MeanShift(const vector<float> & vecVoteColor, const vector<float> & vecVoteWeight, float sigma)
+{
+	typedef Vec<float, cn> Color;
+	const Color * pColor = (const Color *)vecVoteColor.data();
+	int nVotes = (int)vecVoteWeight.size();
+
+	Color vecMean = Color::all(0);
+
+	float fTotalWeight = 0;
+	for (int i = 0; i < nVotes; i++)
+	{
+		vecMean += pColor[i] * vecVoteWeight[i];
+		fTotalWeight += vecVoteWeight[i];
+	}
+
+	vecMean = vecMean / fTotalWeight;
+
+	float fStepThresh = sigma * sigma / 250;
+
+	for (int t = 0; t < 5; t++)
+	{
+		float scale = 3 / (1 << t);// 幅度由3sigma到0.2sigma
+
+		float Thresh = (scale * sigma) * (scale * sigma);
+
+		int nIterNum = 0;
+		while (1)
+		{
+			Color vecCurMean = Color::all(0);
+			int GroupNum = 0;
+
+			fTotalWeight = 0;
+			for (int i = 0; i < nVotes; i++)
+			{
+				Color Diff = pColor[i] - vecMean;
+
+				if (Diff.dot(Diff) < Thresh)
+				{
+					vecCurMean += pColor[i] * vecVoteWeight[i];
+
+					fTotalWeight += vecVoteWeight[i];
+
+					GroupNum++;
+				}
+			}
+
+
+			if (GroupNum == 0)
+			{
+				break;
+			}
+			vecCurMean = vecCurMean / fTotalWeight;
+
+			Color Diff = vecCurMean - vecMean;
+
+			if (Diff.dot(Diff) < fStepThresh)
+			{
+				break;
+			}
+
+			vecMean = vecCurMean;
+
+			nIterNum++;
+			if (nIterNum > 10)
+				break;
+		}
+	}
+
+	return vecMean;
+
+}
+
+template Vec<float, 1> MeanShift<1>(const vector<float> &, const vector<float> &, float);
+template Vec<float, 3> MeanShift<3>(const vector<float> &, const vector<float> &, float);
+template Vec<float, 4> MeanShift<4>(const vector<float> &, const vector<float> &, float);
\ No newline at end of file
@@ -1,171 +1,452 @@
-
-
-#include <opencv.hpp>
-
-using namespace  cv;
-
-
-// PatchMatch: Ѱpatch
-
-
-float DistPatch(const Mat & PatchA, const Mat & PatchB, int PatchSize)
-{
-	return PatchSize * PatchSize * norm(PatchA, PatchB) ;
-}
-
-
-void GuessAndImprove(const Mat & SourceImage, const Mat & TargetImage, const Mat & mask,
-	int x , int y, int Guees_x, int guess_y, int PatchSize, Mat &NearestNeighbor)
-{
-	// ǰpatch
-	if (x == Guees_x && y == guess_y)
-	{
-		return;
-	}
-
-	Rect RE2(Guees_x, guess_y, PatchSize, PatchSize);
-
-	Mat CurMask = mask(RE2);
-	int unValidNum = 0;
-	for (int i = 0; i < CurMask.rows; i++)
-	{
-		for (int j = 0; j < CurMask.cols; j++)
-		{
-			if (CurMask.at<uchar>(i, j))
-			{
-				unValidNum++;
-			}
-		}
-	}
-
-	if (unValidNum  * 10 > CurMask.rows * CurMask.cols)
-	{
-		return;
-	}
-
-	Rect RE(x, y, PatchSize, PatchSize);
-
-	Mat patchA = SourceImage(RE);
-	Mat patchB = TargetImage(RE2);
-
-	int CurDist = DistPatch(patchA, patchB, PatchSize);
-
-	int CurBestDist = NearestNeighbor.at<Vec3i>(y, x)[2];
-
-	if (CurDist < CurBestDist)
-	{
-		NearestNeighbor.at<Vec3i>(y, x)[0] = Guees_x;
-		NearestNeighbor.at<Vec3i>(y, x)[1] = guess_y;
-		NearestNeighbor.at<Vec3i>(y, x)[2] = CurDist;
-	}
-
-
-
-
-}
-
-void PatchMatch(const Mat & SourceImage,const Mat & TargetImage, const Mat & Mask,  int nPatchSize, Mat & NearestNeighbor)
-{
-	// 
-	NearestNeighbor = Mat::zeros(SourceImage.size(), CV_32SC3);
-
-	int nIterNum = 0;
-	int nIterMaxNum = 5;
-	int32_t nMaxCols = TargetImage.cols - nPatchSize - 1;
-	int32_t nMaxRows = TargetImage.rows - nPatchSize - 1;
-
-	// λ
-	for (int i = 0; i < SourceImage.rows - nPatchSize; i++)
-	{
-		for (int j = 0; j < SourceImage.cols - nPatchSize; j++)
-		{
-			int nRandX = rand() % (nMaxCols);   // x 
-			int nRandY = rand() % (nMaxRows);   // y 
-
-			NearestNeighbor.at<Vec3i>(i, j)[0] = nRandX;
-			NearestNeighbor.at<Vec3i>(i, j)[1] = nRandY;
-
-			Rect RE(j, i, nPatchSize, nPatchSize);
-			Mat patchA = SourceImage(RE);
-
-			Rect RE2(nRandX, nRandY, nPatchSize, nPatchSize);
-			Mat patchB = TargetImage(RE2);
-
-			NearestNeighbor.at<Vec3i>(i,j)[2] = DistPatch(patchA, patchB, nPatchSize);
-
-		}
-	}
-
-	while (nIterNum < nIterMaxNum)
-	{
-		int nColStart = 1;
-		int nColEnd = SourceImage.cols - nPatchSize ;
-		int nRowStart = 1;
-		int nRowEnd = SourceImage.rows - nPatchSize ;
-		int nStep = 1;
-
-		if (nIterNum % 2)
-		{
-			nColStart = SourceImage.cols - nPatchSize - 2;
-			nColEnd = -1;
-			nRowStart = SourceImage.rows - nPatchSize - 2;
-			nRowEnd = -1;
-			nStep = -1;
-		}
-
-
-		for (int i = nRowStart; i != nRowEnd; i += nStep)
-		{
-			for (int j = nColStart; j != nColEnd; j += nStep)
-			{
-				// ЧΧ
-				if (j - nStep < SourceImage.cols - nPatchSize)
-				{
-					int nGuessX = NearestNeighbor.at<Vec3i>(i, j - nStep)[0] + nStep;
-					int nGuessY = NearestNeighbor.at<Vec3i>(i, j - nStep)[1];
-
-					if (nGuessX < TargetImage.cols - nPatchSize && nGuessX >= 0)
-					{
-						// propagation 
-						GuessAndImprove(SourceImage, TargetImage, Mask, j, i, nGuessX, nGuessY, nPatchSize, NearestNeighbor);
-					}
-
-				}
-				// ЧΧ
-				if (i - nStep < SourceImage.rows - nPatchSize)
-				{
-					int nGuessX = NearestNeighbor.at<Vec3i>(i - nStep, j)[0];
-					int nGuessY = NearestNeighbor.at<Vec3i>(i - nStep, j)[1] + nStep;
-
-					if (nGuessY < TargetImage.rows - nPatchSize && nGuessY >= 0)
-					{
-						// propagation 
-						GuessAndImprove(SourceImage, TargetImage, Mask, j, i, nGuessX, nGuessY, nPatchSize, NearestNeighbor);
-					}
-				}
-
-				// random guess
-
-				int rs_start = max(TargetImage.rows,  TargetImage.cols);
-
-				int nBestX = NearestNeighbor.at<Vec3i>(i, j)[0];
-				int nBestY = NearestNeighbor.at<Vec3i>(i, j)[1];
-
-				for (int mag = rs_start; mag >= 1; mag /= 2) 
-				{
-					/* Sampling window */
-					int xmin = max(nBestX - mag, 0), xmax = min(nBestX + mag + 1, TargetImage.cols - nPatchSize - 1);
-					int ymin = max(nBestY - mag, 0), ymax = min(nBestY + mag + 1, TargetImage.rows - nPatchSize - 1);
-
-					int xp = xmin + rand() % (xmax - xmin);
-					int yp = ymin + rand() % (ymax - ymin);
-
-					GuessAndImprove(SourceImage, TargetImage, Mask, j, i, xp, yp,  nPatchSize, NearestNeighbor);
-
-				}
-			}
-		}
-
-		nIterNum++;
-	}
-}
\ No newline at end of file
+
+
+#include <opencv.hpp>
+#include <atomic>
+#include <cfloat>
+#include <vector>
+#include "src/nnf.h"
+#include "src/workspace.h"
+
+using namespace  cv;
+
+
+// PatchMatch: 快速寻找patch块的最近邻
+
+
+// One channel's contribution to the SSD, and the type a patch's sum of them
+// is kept in: 8 bit sums fit an int up to 90x90 four channel patches, 16 bit
+// ones need 64 bits. The distance stays a plain sum of integer terms, so the
+// propagation updates below stay exact.
+template<typename T> struct SsdTerm;
+
+template<> struct SsdTerm<uchar>
+{
+	typedef int Sum;
+	static inline int of(int d) { return d * d; }
+};
+
+template<> struct SsdTerm<ushort>
+{
+	typedef int64 Sum;
+	static inline int64 of(int d) { return (int64)d * d; }
+};
+
+// Sum of squared differences between the patch at (ax, ay) in ImageA and the
+// patch at (bx, by) in ImageB, read straight from the rows (no ROI headers).
+template<typename T, int cn>
+int64 PatchSSD(const Mat & ImageA, int ax, int ay, const Mat & ImageB, int bx, int by, int PatchSize)
+{
+	typename SsdTerm<T>::Sum ssd = 0;
+	for (int r = 0; r < PatchSize; r++)
+	{
+		const T * pA = ImageA.ptr<T>(ay + r) + ax * cn;
+		const T * pB = ImageB.ptr<T>(by + r) + bx * cn;
+		for (int c = 0; c < PatchSize * cn; c++)
+		{
+			ssd += SsdTerm<T>::of(pA[c] - pB[c]);
+		}
+	}
+	return ssd;
+}
+
+// SSD of the single column at (ax, ay) / (bx, by), PatchSize pixels tall.
+template<typename T, int cn>
+static int64 ColumnSSD(const Mat & ImageA, int ax, int ay, const Mat & ImageB, int bx, int by, int PatchSize)
+{
+	typename SsdTerm<T>::Sum ssd = 0;
+	for (int r = 0; r < PatchSize; r++)
+	{
+		const T * pA = ImageA.ptr<T>(ay + r) + ax * cn;
+		const T * pB = ImageB.ptr<T>(by + r) + bx * cn;
+		for (int c = 0; c < cn; c++)
+		{
+			ssd += SsdTerm<T>::of(pA[c] - pB[c]);
+		}
+	}
+	return ssd;
+}
+
+// SSD of the single row at (ax, ay) / (bx, by), PatchSize pixels wide.
+template<typename T, int cn>
+static int64 RowSSD(const Mat & ImageA, int ax, int ay, const Mat & ImageB, int bx, int by, int PatchSize)
+{
+	const T * pA = ImageA.ptr<T>(ay) + ax * cn;
+	const T * pB = ImageB.ptr<T>(by) + bx * cn;
+	typename SsdTerm<T>::Sum ssd = 0;
+	for (int c = 0; c < PatchSize * cn; c++)
+	{
+		ssd += SsdTerm<T>::of(pA[c] - pB[c]);
+	}
+	return ssd;
+}
+
+// PatchHoles holds, at every patch corner, the sum of the 0/255 hole mask
+// under the patch. Candidates more than a tenth inside the hole are no source.
+static inline bool CandidateUsable(const Mat & PatchHoles, int x, int y, int Guees_x, int guess_y, int PatchSize)
+{
+	// 当前的patch块
+	if (x == Guees_x && y == guess_y)
+	{
+		return false;
+	}
+
+	return PatchHoles.at<int>(guess_y, Guees_x) * 10 <= PatchSize * PatchSize * 255;
+}
+
+static inline void Improve(Mat & NearestNeighbor, int x, int y, int Guees_x, int guess_y, int64 CurDist)
+{
+	NnfEntry & CurBest = NearestNeighbor.at<NnfEntry>(y, x);
+	if (CurDist < CurBest.dist)
+	{
+		CurBest.x = Guees_x;
+		CurBest.y = guess_y;
+		CurBest.dist = CurDist;
+	}
+}
+
+template<typename T, int cn>
+static void GuessAndImprove(const Mat & SourceImage, const Mat & TargetImage, const Mat & PatchHoles,
+	int x , int y, int Guees_x, int guess_y, int PatchSize, Mat &NearestNeighbor)
+{
+	if (!CandidateUsable(PatchHoles, x, y, Guees_x, guess_y, PatchSize))
+	{
+		return;
+	}
+
+	Improve(NearestNeighbor, x, y, Guees_x, guess_y, PatchSSD<T, cn>(SourceImage, x, y, TargetImage, Guees_x, guess_y, PatchSize));
+}
+
+// NearestNeighbor is reused when it already has the right size and type, and
+// the random draws come from the caller's rng, so concurrent solves neither
+// allocate here nor contend on the global rand() state.
+// Only patches whose top-left corner lies in Region are matched; the other
+// entries stay zero. Callers pass the patches that overlap the hole.
+// With bWarmStart the offsets already in NearestNeighbor seed the search
+// instead of random ones; only their distances are recomputed.
+// NearestNeighbor is NNF_TYPE; dist holds the exact SSD of every entry. A propagated
+// candidate is the neighbour's match shifted by one pixel, so its SSD is the
+// neighbour's minus the column (or row) that leaves plus the one that enters:
+// O(P) instead of O(P^2). The hole test reads PatchHoles (see
+// CandidateUsable), so it is O(1) whichever way the SSD is found.
+// nSweeps alternating scan passes are run; a warm start needs fewer.
+// pCancel is polled once per row; the return value is false when it stopped
+// the search, and NearestNeighbor is then only partly improved.
+// Instantiated below for 8 and 16 bit images of 1, 3 and 4 channels.
+template<typename T, int cn>
+bool PatchMatch(const Mat & SourceImage,const Mat & TargetImage, const Mat & PatchHoles,  int nPatchSize, Mat & NearestNeighbor, RNG & rng, Rect Region, bool bWarmStart,
+	int nSweeps, const std::atomic<bool> * pCancel)
+{
+	// 最近邻数据
+	if (!bWarmStart || NearestNeighbor.size() != SourceImage.size() || NearestNeighbor.type() != NNF_TYPE)
+	{
+		NearestNeighbor.create(SourceImage.size(), NNF_TYPE);
+		NearestNeighbor.setTo(Scalar::all(0));
+		bWarmStart = false;
+	}
+
+	int nIterNum = 0;
+	int nIterMaxNum = nSweeps;
+	int32_t nMaxCols = TargetImage.cols - nPatchSize - 1;
+	int32_t nMaxRows = TargetImage.rows - nPatchSize - 1;
+
+	Region &= Rect(0, 0, SourceImage.cols - nPatchSize, SourceImage.rows - nPatchSize);
+	int x0 = Region.x, x1 = Region.x + Region.width;
+	int y0 = Region.y, y1 = Region.y + Region.height;
+
+	// 先设置随机位置
+	for (int i = y0; i < y1; i++)
+	{
+		if (pCancel && pCancel->load(std::memory_order_relaxed))
+			return false;
+
+		for (int j = x0; j < x1; j++)
+		{
+			NnfEntry & Entry = NearestNeighbor.at<NnfEntry>(i, j);
+			int nRandX, nRandY;
+			if (bWarmStart)
+			{
+				nRandX = min(max(Entry.x, 0), (int)nMaxCols);
+				nRandY = min(max(Entry.y, 0), (int)nMaxRows);
+			}
+			else
+			{
+				nRandX = rng.uniform(0, nMaxCols);   // x 坐标
+				nRandY = rng.uniform(0, nMaxRows);   // y 坐标
+			}
+
+			Entry.x = nRandX;
+			Entry.y = nRandY;
+
+			Entry.dist = PatchSSD<T, cn>(SourceImage, j, i, TargetImage, nRandX, nRandY, nPatchSize);
+
+		}
+	}
+
+	while (nIterNum < nIterMaxNum)
+	{
+		int nColStart = x0;
+		int nColEnd = x1;
+		int nRowStart = y0;
+		int nRowEnd = y1;
+		int nStep = 1;
+
+		if (nIterNum % 2)
+		{
+			nColStart = x1 - 1;
+			nColEnd = x0 - 1;
+			nRowStart = y1 - 1;
+			nRowEnd = y0 - 1;
+			nStep = -1;
+		}
+
+
+		for (int i = nRowStart; i != nRowEnd; i += nStep)
+		{
+			if (pCancel && pCancel->load(std::memory_order_relaxed))
+				return false;
+
+			for (int j = nColStart; j != nColEnd; j += nStep)
+			{
+				// 有效范围内
+				if (j - nStep >= x0 && j - nStep < x1)
+				{
+					const NnfEntry & Prev = NearestNeighbor.at<NnfEntry>(i, j - nStep);
+					int nGuessX = Prev.x + nStep;
+					int nGuessY = Prev.y;
+
+					if (nGuessX < TargetImage.cols - nPatchSize && nGuessX >= 0
+						&& CandidateUsable(PatchHoles, j, i, nGuessX, nGuessY, nPatchSize))
+					{
+						// propagation: one column leaves, one enters
+						int nLeaveA = nStep > 0 ? j - 1 : j + nPatchSize;
+						int nLeaveB = nStep > 0 ? Prev.x : Prev.x + nPatchSize - 1;
+						int nEnterA = nStep > 0 ? j + nPatchSize - 1 : j;
+						int nEnterB = nStep > 0 ? nGuessX + nPatchSize - 1 : nGuessX;
+						int64 CurDist = Prev.dist
+							- ColumnSSD<T, cn>(SourceImage, nLeaveA, i, TargetImage, nLeaveB, nGuessY, nPatchSize)
+							+ ColumnSSD<T, cn>(SourceImage, nEnterA, i, TargetImage, nEnterB, nGuessY, nPatchSize);
+						Improve(NearestNeighbor, j, i, nGuessX, nGuessY, CurDist);
+					}
+
+				}
+				// 有效范围内
+				if (i - nStep >= y0 && i - nStep < y1)
+				{
+					const NnfEntry & Prev = NearestNeighbor.at<NnfEntry>(i - nStep, j);
+					int nGuessX = Prev.x;
+					int nGuessY = Prev.y + nStep;
+
+					if (nGuessY < TargetImage.rows - nPatchSize && nGuessY >= 0
+						&& CandidateUsable(PatchHoles, j, i, nGuessX, nGuessY, nPatchSize))
+					{
+						// propagation: one row leaves, one enters
+						int nLeaveA = nStep > 0 ? i - 1 : i + nPatchSize;
+						int nLeaveB = nStep > 0 ? Prev.y : Prev.y + nPatchSize - 1;
+						int nEnterA = nStep > 0 ? i + nPatchSize - 1 : i;
+						int nEnterB = nStep > 0 ? nGuessY + nPatchSize - 1 : nGuessY;
+						int64 CurDist = Prev.dist
+							- RowSSD<T, cn>(SourceImage, j, nLeaveA, TargetImage, nGuessX, nLeaveB, nPatchSize)
+							+ RowSSD<T, cn>(SourceImage, j, nEnterA, TargetImage, nGuessX, nEnterB, nPatchSize);
+						Improve(NearestNeighbor, j, i, nGuessX, nGuessY, CurDist);
+					}
+				}
+
+				// random guess
+
+				int rs_start = max(TargetImage.rows,  TargetImage.cols);
+
+				int nBestX = NearestNeighbor.at<NnfEntry>(i, j).x;
+				int nBestY = NearestNeighbor.at<NnfEntry>(i, j).y;
+
+				for (int mag = rs_start; mag >= 1; mag /= 2) 
+				{
+					/* Sampling window */
+					int xmin = max(nBestX - mag, 0), xmax = min(nBestX + mag + 1, TargetImage.cols - nPatchSize - 1);
+					int ymin = max(nBestY - mag, 0), ymax = min(nBestY + mag + 1, TargetImage.rows - nPatchSize - 1);
+
+					int xp = rng.uniform(xmin, xmax);
+					int yp = rng.uniform(ymin, ymax);
+
+					GuessAndImprove<T, cn>(SourceImage, TargetImage, PatchHoles, j, i, xp, yp,  nPatchSize, NearestNeighbor);
+
+				}
+			}
+		}
+
+		nIterNum++;
+	}
+	return true;
+}
+
+// Exact nearest neighbours for small levels: every patch corner in Region is
+// scored against every source corner, and the best usable one (see
+// CandidateUsable) wins, which is the optimum PatchMatch only approaches.
+// SSD(p, q) = |patch p|^2 + E(q) - 2 C(q), where E is the window energy of
+// the image and C the cross-correlation of patch p with it. The image is
+// transformed once per call and each patch once, so a patch costs one DFT of
+// the level per channel instead of P^2 products per source corner. Scores are
+// doubles, exact for 8 bit and up to rounding of near ties for 16 bit images.
+// The stored distance is PatchSSD of the winner, as in PatchMatch, and so are
+// the NNF layout, Region and pCancel contract. Scratch is only reused when
+// InpaintWorkspace::prepare sized it for the level, otherwise it is created.
+template<typename T, int cn>
+bool ExactNNF(const Mat & Image, const Mat & PatchHoles, int nPatchSize, Mat & NearestNeighbor, Rect Region,
+	ExactNNFBuffers & Scratch, const std::atomic<bool> * pCancel)
+{
+	if (NearestNeighbor.size() != Image.size() || NearestNeighbor.type() != NNF_TYPE)
+	{
+		NearestNeighbor.create(Image.size(), NNF_TYPE);
+		NearestNeighbor.setTo(Scalar::all(0));
+	}
+
+	// same candidate range as the random search of PatchMatch
+	int nMaxCols = Image.cols - nPatchSize - 1;
+	int nMaxRows = Image.rows - nPatchSize - 1;
+
+	Region &= Rect(0, 0, Image.cols - nPatchSize, Image.rows - nPatchSize);
+	if (Region.empty() || nMaxCols < 0 || nMaxRows < 0)
+		return true;
+
+	// 整幅图各通道的频谱，以及每个窗口的能量
+	Size DftSize(getOptimalDFTSize(Image.cols), getOptimalDFTSize(Image.rows));
+	Image.convertTo(Scratch.image64, CV_64F);
+	std::vector<Mat> & Planes = Scratch.planes;
+	std::vector<Mat> & Spectra = Scratch.spectra;
+	split(Scratch.image64, Planes);
+	Spectra.resize(cn);
+
+	Mat & Energy = Scratch.energy;
+	Energy.create(Image.size(), CV_64F);
+	Energy.setTo(Scalar::all(0));
+	for (int c = 0; c < cn; c++)
+	{
+		accumulateSquare(Planes[c], Energy);
+
+		copyMakeBorder(Planes[c], Scratch.padded, 0, DftSize.height - Image.rows, 0, DftSize.width - Image.cols,
+			BORDER_CONSTANT, Scalar::all(0));
+		dft(Scratch.padded, Spectra[c]);
+	}
+	boxFilter(Energy, Energy, CV_64F, Size(nPatchSize, nPatchSize), Point(0, 0), false);
+
+	// only the top-left PxP block of the kernel is ever written
+	Mat & Kernel = Scratch.kernel;
+	Kernel.create(DftSize, CV_64F);
+	Kernel.setTo(Scalar::all(0));
+	Mat KernelBlock = Kernel(Rect(0, 0, nPatchSize, nPatchSize));
+	Mat & KernelSpectrum = Scratch.kernelSpectrum;
+	Mat & Product = Scratch.product;
+	Mat & Sum = Scratch.sum;
+	Mat & Correlation = Scratch.correlation;
+
+	for (int i = Region.y; i < Region.y + Region.height; i++)
+	{
+		if (pCancel && pCancel->load(std::memory_order_relaxed))
+			return false;
+
+		for (int j = Region.x; j < Region.x + Region.width; j++)
+		{
+			// 各通道的相关在频域相加，只做一次反变换
+			for (int c = 0; c < cn; c++)
+			{
+				Planes[c](Rect(j, i, nPatchSize, nPatchSize)).copyTo(KernelBlock);
+				dft(Kernel, KernelSpectrum, 0, nPatchSize);
+				mulSpectrums(Spectra[c], KernelSpectrum, c == 0 ? Sum : Product, 0, true);
+				if (c > 0)
+					Sum += Product;
+			}
+			dft(Sum, Correlation, DFT_INVERSE | DFT_SCALE | DFT_REAL_OUTPUT);
+
+			// a patch with no usable source at all keeps the best other one
+			int nBestX = -1, nBestY = -1, nAnyX = -1, nAnyY = -1;
+			double fBest = DBL_MAX, fAny = DBL_MAX;
+			for (int y = 0; y <= nMaxRows; y++)
+			{
+				const double * pEnergy = Energy.ptr<double>(y);
+				const double * pCorrelation = Correlation.ptr<double>(y);
+				for (int x = 0; x <= nMaxCols; x++)
+				{
+					double fScore = pEnergy[x] - 2 * pCorrelation[x];
+					if (fScore >= fBest)
+						continue;
+					if (x == j && y == i)
+						continue;
+
+					if (fScore < fAny)
+					{
+						fAny = fScore;
+						nAnyX = x;
+						nAnyY = y;
+					}
+					if (fScore < fBest && CandidateUsable(PatchHoles, j, i, x, y, nPatchSize))
+					{
+						fBest = fScore;
+						nBestX = x;
+						nBestY = y;
+					}
+				}
+			}
+			if (nBestX < 0)
+			{
+				nBestX = nAnyX;
+				nBestY = nAnyY;
+			}
+			if (nBestX < 0)
+				continue;
+
+			NnfEntry & Entry = NearestNeighbor.at<NnfEntry>(i, j);
+			Entry.x = nBestX;
+			Entry.y = nBestY;
+			Entry.dist = PatchSSD<T, cn>(Image, j, i, Image, nBestX, nBestY, nPatchSize);
+		}
+	}
+	return true;
+}
+
+// Seeds the NNF of a finer level from the one of a coarser level: every entry
+// in Region takes the offset of the coarse entry it falls in, scaled by the
+// size ratio of the levels and clamped to the valid patch corners. Entries
+// whose coarse parent lies outside CoarseRegion were never matched, and those
+// that would land on themselves never improve; both start from a random
+// source instead. PatchMatch then refines the result with bWarmStart.
+void UpsampleNNF(const Mat & CoarseNNF, Rect CoarseRegion, Mat & FineNNF, Rect Region, int nPatchSize, RNG & rng)
+{
+	float fScaleX = (float)FineNNF.cols / CoarseNNF.cols;
+	float fScaleY = (float)FineNNF.rows / CoarseNNF.rows;
+	int nMaxCols = FineNNF.cols - nPatchSize - 1;
+	int nMaxRows = FineNNF.rows - nPatchSize - 1;
+
+	Region &= Rect(0, 0, FineNNF.cols - nPatchSize, FineNNF.rows - nPatchSize);
+	for (int i = Region.y; i < Region.y + Region.height; i++)
+	{
+		int cy = min((int)(i / fScaleY), CoarseNNF.rows - 1);
+		for (int j = Region.x; j < Region.x + Region.width; j++)
+		{
+			int cx = min((int)(j / fScaleX), CoarseNNF.cols - 1);
+			NnfEntry & Fine = FineNNF.at<NnfEntry>(i, j);
+
+			if (CoarseRegion.contains(Point(cx, cy)))
+			{
+				const NnfEntry & Coarse = CoarseNNF.at<NnfEntry>(cy, cx);
+				Fine.x = min(max(cvRound(j + (Coarse.x - cx) * fScaleX), 0), nMaxCols);
+				Fine.y = min(max(cvRound(i + (Coarse.y - cy) * fScaleY), 0), nMaxRows);
+				if (Fine.x != j || Fine.y != i)
+					continue;
+			}
+
+			Fine.x = rng.uniform(0, nMaxCols);
+			Fine.y = rng.uniform(0, nMaxRows);
+		}
+	}
+}
+
+#define INSTANTIATE_PATCHMATCH(T, cn) \
+	template int64 PatchSSD<T, cn>(const Mat &, int, int, const Mat &, int, int, int); \
+	template bool PatchMatch<T, cn>(const Mat &, const Mat &, const Mat &, int, Mat &, RNG &, Rect, bool, int, const std::atomic<bool> *); \
+	template bool ExactNNF<T, cn>(const Mat &, const Mat &, int, Mat &, Rect, ExactNNFBuffers &, const std::atomic<bool> *);
+
+INSTANTIATE_PATCHMATCH(uchar, 1)
+INSTANTIATE_PATCHMATCH(uchar, 3)
+INSTANTIATE_PATCHMATCH(uchar, 4)
+INSTANTIATE_PATCHMATCH(ushort, 1)
+INSTANTIATE_PATCHMATCH(ushort, 3)
+INSTANTIATE_PATCHMATCH(ushort, 4)
\ No newline at end of file
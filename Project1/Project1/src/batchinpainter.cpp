@@ -0,0 +1,268 @@
+#include "batchinpainter.h"
+#include "threadpool.h"
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+
+using namespace cv;
+using namespace std;
+
+BatchInpainter::BatchInpainter(Mat inputImage, const vector<Mat> & masks, int halfPatchWidth)
+{
+	this->inputImage = inputImage;
+	this->masks = masks;
+	this->halfPatchWidth = halfPatchWidth;
+	keepGroupResults = false;
+}
+
+BatchInpainter::BatchInpainter(Mat inputImage, Mat labels, int halfPatchWidth)
+{
+	this->inputImage = inputImage;
+	this->halfPatchWidth = halfPatchWidth;
+	keepGroupResults = false;
+
+	Mat Labels;
+	labels.convertTo(Labels, CV_32S);
+
+	// one mask per label, in ascending label order
+	map<int, int> MaskOfLabel;
+	for (int i = 0; i < Labels.rows; i++)
+	{
+		for (int j = 0; j < Labels.cols; j++)
+		{
+			int nLabel = Labels.at<int>(i, j);
+			if (nLabel != 0)
+				MaskOfLabel[nLabel] = 0;
+		}
+	}
+
+	for (map<int, int>::iterator it = MaskOfLabel.begin(); it != MaskOfLabel.end(); ++it)
+	{
+		it->second = (int)masks.size();
+		masks.push_back(Mat::zeros(Labels.size(), CV_8UC1));
+	}
+
+	for (int i = 0; i < Labels.rows; i++)
+	{
+		for (int j = 0; j < Labels.cols; j++)
+		{
+			int nLabel = Labels.at<int>(i, j);
+			if (nLabel != 0)
+				masks[MaskOfLabel[nLabel]].at<uchar>(i, j) = 255;
+		}
+	}
+}
+
+int BatchInpainter::checkValidInputs()
+{
+	if (!options.checkpointPath.empty() || options.resumeFrom || options.warmStartFrom)
+		return Inpainter::ERROR_CHECKPOINT_UNSUPPORTED;
+	if (!Inpainter::supportsType(inputImage.type()))
+		return Inpainter::ERROR_INPUT_MAT_INVALID_TYPE;
+	for (size_t i = 0; i < masks.size(); i++)
+	{
+		int nCheck = Inpainter::checkInputs(inputImage, masks[i], halfPatchWidth, options);
+		if (nCheck != Inpainter::CHECK_VALID)
+			return nCheck;
+	}
+	return Inpainter::CHECK_VALID;
+}
+
+static Rect nonZeroRect(const Mat & mask)
+{
+	Point Min(mask.cols, mask.rows), Max(-1, -1);
+	for (int i = 0; i < mask.rows; i++)
+	{
+		const uchar * pMask = mask.ptr<uchar>(i);
+		for (int j = 0; j < mask.cols; j++)
+		{
+			if (pMask[j])
+			{
+				Min = Point(min(Min.x, j), min(Min.y, i));
+				Max = Point(max(Max.x, j), max(Max.y, i));
+			}
+		}
+	}
+
+	if (Max.x < 0)
+		return Rect();
+	return Rect(Min.x, Min.y, Max.x - Min.x + 1, Max.y - Min.y + 1);
+}
+
+static int findRoot(vector<int> & parent, int n)
+{
+	while (parent[n] != n)
+	{
+		parent[n] = parent[parent[n]];
+		n = parent[n];
+	}
+	return n;
+}
+
+void BatchInpainter::mergeInteractingMasks()
+{
+	int PatchSize = 2 * halfPatchWidth + 1;
+	int nMasks = (int)masks.size();
+
+	// The patches voting for a hole reach PatchSize - 1 pixels out of it. The
+	// other holes are no source, but a solve still sees their unfilled pixels
+	// around its own hole; holes closer than about two patch widths would
+	// read each other's content, so grow every mask by PatchSize and merge
+	// the ones whose grown regions meet.
+	Mat Kernel = getStructuringElement(MORPH_RECT, Size(2 * PatchSize + 1, 2 * PatchSize + 1));
+	vector<Mat> Reach(nMasks);
+	vector<Rect> ReachRect(nMasks);
+	for (int i = 0; i < nMasks; i++)
+	{
+		dilate(masks[i], Reach[i], Kernel);
+		ReachRect[i] = nonZeroRect(Reach[i]);
+	}
+
+	vector<int> parent(nMasks);
+	for (int i = 0; i < nMasks; i++)
+		parent[i] = i;
+
+	for (int i = 0; i < nMasks; i++)
+	{
+		for (int j = i + 1; j < nMasks; j++)
+		{
+			Rect Both = ReachRect[i] & ReachRect[j];
+			if (Both.area() == 0)
+				continue;
+
+			Mat Overlap = Reach[i](Both) & Reach[j](Both);
+			if (countNonZero(Overlap) > 0)
+				parent[findRoot(parent, j)] = findRoot(parent, i);
+		}
+	}
+
+	groupOf.assign(nMasks, -1);
+	groupMasks.clear();
+
+	vector<int> GroupOfRoot(nMasks, -1);
+	for (int i = 0; i < nMasks; i++)
+	{
+		int nRoot = findRoot(parent, i);
+		if (GroupOfRoot[nRoot] < 0)
+		{
+			GroupOfRoot[nRoot] = (int)groupMasks.size();
+			groupMasks.push_back(Mat::zeros(inputImage.size(), CV_8UC1));
+		}
+
+		groupOf[i] = GroupOfRoot[nRoot];
+		groupMasks[groupOf[i]].setTo(Scalar::all(255), masks[i]);
+	}
+}
+
+bool BatchInpainter::inpaint(int nThreads)
+{
+	mergeInteractingMasks();
+
+	int nGroups = (int)groupMasks.size();
+	results.assign(keepGroupResults ? nGroups : 0, Mat());
+	inputImage.copyTo(result);
+
+	if (nGroups == 0)
+		return true;
+
+	SourcePyramid pyramid(inputImage, options.schedule.maxLevels);
+
+	// every removed object is no source for any solve, not just its own
+	InpaintOptions GroupOptions = options;
+	Mat AllMasks = Mat::zeros(inputImage.size(), CV_8UC1);
+	if (!options.excludeFromSource.empty())
+		options.excludeFromSource.copyTo(AllMasks);
+	for (int g = 0; g < nGroups; g++)
+		AllMasks.setTo(Scalar::all(255), groupMasks[g]);
+	GroupOptions.excludeFromSource = AllMasks;
+
+	// the groups would all write one file and resume from each other's state
+	GroupOptions.checkpointPath.clear();
+	GroupOptions.resumeFrom = 0;
+	GroupOptions.warmStartFrom = 0;
+
+	// a private pool only when the caller caps the thread count
+	unique_ptr<ThreadPool> OwnPool;
+	if (nThreads > 0)
+		OwnPool.reset(new ThreadPool(min(nThreads, nGroups)));
+	ThreadPool & pool = OwnPool ? *OwnPool : ThreadPool::shared();
+
+	// one workspace per worker, handed to whichever solve starts next
+	vector<InpaintWorkspace> workspaces(pool.size());
+	vector<InpaintWorkspace *> freeWorkspaces;
+	for (size_t i = 0; i < workspaces.size(); i++)
+		freeWorkspaces.push_back(&workspaces[i]);
+	mutex workspaceMutex;
+
+	vector<char> solved(nGroups, 0);
+	vector<future<void> > done;
+	for (int g = 0; g < nGroups; g++)
+	{
+		done.push_back(pool.submit([&, g]() {
+			InpaintWorkspace * ws;
+			{
+				lock_guard<mutex> lock(workspaceMutex);
+				ws = freeWorkspaces.back();
+				freeWorkspaces.pop_back();
+			}
+
+			// seeded per solve so the output does not depend on scheduling
+			ws->rng = RNG(g + 1);
+
+			// the groups' holes are disjoint, so every solve writes its own
+			// pixels of the shared result
+			try
+			{
+				solved[g] = inpaintHoleInto(pyramid, groupMasks[g], halfPatchWidth, GroupOptions, *ws, result);
+			}
+			catch (...)
+			{
+				lock_guard<mutex> lock(workspaceMutex);
+				freeWorkspaces.push_back(ws);
+				throw;
+			}
+
+			lock_guard<mutex> lock(workspaceMutex);
+			freeWorkspaces.push_back(ws);
+		}));
+	}
+
+	// the tasks use the locals above, so every one has to finish before an
+	// exception may leave this function
+	exception_ptr FirstError;
+	for (int g = 0; g < nGroups; g++)
+	{
+		try
+		{
+			done[g].get();
+		}
+		catch (...)
+		{
+			if (!FirstError)
+				FirstError = current_exception();
+		}
+	}
+	if (FirstError)
+		rethrow_exception(FirstError);
+
+	// cancelled: result goes back to the input image
+	for (int g = 0; g < nGroups; g++)
+	{
+		if (!solved[g])
+		{
+			inputImage.copyTo(result);
+			return false;
+		}
+	}
+
+	if (keepGroupResults)
+	{
+		for (int g = 0; g < nGroups; g++)
+		{
+			inputImage.copyTo(results[g]);
+			result.copyTo(results[g], groupMasks[g]);
+		}
+	}
+	return true;
+}
@@ -0,0 +1,47 @@
+#ifndef BATCHINPAINTER_H
+#define BATCHINPAINTER_H
+
+
+#include <opencv.hpp>
+#include <vector>
+#include "inpainter.h"
+
+// Several independent removals on one photo, e.g. one mask per detected
+// object. The source pyramid is built once and shared read-only by all
+// solves; every solve keeps its own workspace and runs on a thread pool.
+// Masks whose holes lie close enough for their patch neighbourhoods to
+// interact are merged into a single solve, and no solve copies from the
+// pixels under any of the masks.
+class BatchInpainter
+{
+public:
+    BatchInpainter(cv::Mat inputImage, const std::vector<cv::Mat> & masks, int halfPatchWidth=4);
+    // labels is CV_8UC1 or CV_32SC1, every distinct non-zero value is one mask
+    BatchInpainter(cv::Mat inputImage, cv::Mat labels, int halfPatchWidth=4);
+
+    // not copied, must stay untouched until inpaint() returns
+    cv::Mat inputImage;
+    std::vector<cv::Mat> masks;
+
+    int halfPatchWidth;
+    InpaintOptions options;     // checkpoint fields are not supported
+
+    std::vector<int> groupOf;           // solve that handled each mask
+    std::vector<cv::Mat> groupMasks;    // union of the masks of each solve
+    cv::Mat result;                     // inputImage with every hole filled
+    // inputImage with one solve's hole filled, only with keepGroupResults
+    std::vector<cv::Mat> results;
+    bool keepGroupResults;              // default false
+
+    int checkValidInputs();
+
+    // nThreads <= 0 runs on the shared pool, otherwise on a private pool of
+    // that many threads. False when options.cancel stopped a solve.
+    bool inpaint(int nThreads = 0);
+
+private:
+    void mergeInteractingMasks();
+};
+
+
+#endif // BATCHINPAINTER_H
@@ -0,0 +1,94 @@
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+// FIFO of at most capacity items. push blocks while the queue is full and pop
+// while it is empty, which gives backpressure between pipeline stages. After
+// close() push fails and pop drains what is left, then fails.
+template<typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(size_t capacity) : capacity(capacity), closed(false) {}
+
+    bool push(const T & item)
+    {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        notFull.wait(lock, [this]() { return closed || items.size() < capacity; });
+        if (closed)
+            return false;
+        items.push_back(item);
+        lock.unlock();
+        notEmpty.notify_one();
+        return true;
+    }
+
+    // Like push, but fails at once instead of waiting when the queue is full.
+    bool tryPush(const T & item)
+    {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        if (closed || items.size() >= capacity)
+            return false;
+        items.push_back(item);
+        lock.unlock();
+        notEmpty.notify_one();
+        return true;
+    }
+
+    bool pop(T & item)
+    {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        notEmpty.wait(lock, [this]() { return closed || !items.empty(); });
+        if (items.empty())
+            return false;
+        item = items.front();
+        items.pop_front();
+        lock.unlock();
+        notFull.notify_one();
+        return true;
+    }
+
+    // Like pop, but fails at once instead of waiting when the queue is empty.
+    bool tryPop(T & item)
+    {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        if (items.empty())
+            return false;
+        item = items.front();
+        items.pop_front();
+        lock.unlock();
+        notFull.notify_one();
+        return true;
+    }
+
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            closed = true;
+        }
+        notFull.notify_all();
+        notEmpty.notify_all();
+    }
+
+    size_t size()
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        return items.size();
+    }
+
+private:
+    size_t capacity;
+    bool closed;
+    std::deque<T> items;
+    std::mutex queueMutex;
+    std::condition_variable notFull;
+    std::condition_variable notEmpty;
+};
+
+
+#endif // BOUNDEDQUEUE_H
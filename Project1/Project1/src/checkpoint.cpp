@@ -0,0 +1,268 @@
+#include "checkpoint.h"
+#include "sourcepyramid.h"
+#include "nnf.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace cv;
+using namespace std;
+
+static const char CHECKPOINT_MAGIC[8] = "STCKPT";
+
+static uint64_t alignSection(uint64_t nOffset)
+{
+	return (nOffset + 63) & ~(uint64_t)63;
+}
+
+// Pads the file with zeros up to nOffset, then writes the rows of m.
+static bool writeSection(FILE * f, uint64_t & nPos, uint64_t nOffset, const Mat & m)
+{
+	static const char Zeros[64] = { 0 };
+	if (nOffset - nPos > sizeof(Zeros))
+		return false;
+	if (nOffset > nPos && fwrite(Zeros, 1, (size_t)(nOffset - nPos), f) != nOffset - nPos)
+		return false;
+	nPos = nOffset;
+
+	size_t nRowBytes = m.cols * m.elemSize();
+	for (int i = 0; i < m.rows; i++)
+	{
+		if (fwrite(m.ptr(i), 1, nRowBytes, f) != nRowBytes)
+			return false;
+		nPos += nRowBytes;
+	}
+	return true;
+}
+
+// The section lies inside the file and holds rows x cols elements of type.
+static bool sectionFits(const CheckpointHeader & h, uint64_t nOffset, uint64_t nStep, int rows, int cols, int type)
+{
+	if (rows <= 0 || cols <= 0 || nOffset % 64 != 0)
+		return false;
+	if (nStep < (uint64_t)cols * CV_ELEM_SIZE(type))
+		return false;
+	return nOffset >= h.headerSize && nOffset + nStep * rows <= h.fileSize;
+}
+
+SolverCheckpoint::SolverCheckpoint()
+{
+	view = 0;
+	viewSize = 0;
+#ifdef _WIN32
+	file = 0;
+	mapping = 0;
+#endif
+}
+
+SolverCheckpoint::~SolverCheckpoint()
+{
+	close();
+}
+
+bool SolverCheckpoint::isOpened() const
+{
+	return view != 0;
+}
+
+bool SolverCheckpoint::matches(Size imageSize, int imageType, int halfPatchWidth,
+	uint64_t sourceHash, uint64_t maskHash) const
+{
+	return isOpened()
+		&& state.imageSize == imageSize
+		&& state.imageType == imageType
+		&& state.halfPatchWidth == halfPatchWidth
+		&& state.sourceHash == sourceHash
+		&& state.maskHash == maskHash
+		&& state.work.size() == SourcePyramid::levelSize(imageSize, state.level);
+}
+
+uint64_t SolverCheckpoint::hash(const Mat & m)
+{
+	uint64_t h = 14695981039346656037ULL;
+	int Shape[3] = { m.rows, m.cols, m.type() };
+	const uchar * pShape = (const uchar *)Shape;
+	for (size_t k = 0; k < sizeof(Shape); k++)
+		h = (h ^ pShape[k]) * 1099511628211ULL;
+
+	size_t nRowBytes = m.cols * m.elemSize();
+	for (int i = 0; i < m.rows; i++)
+	{
+		const uchar * p = m.ptr(i);
+		for (size_t k = 0; k < nRowBytes; k++)
+			h = (h ^ p[k]) * 1099511628211ULL;
+	}
+	return h;
+}
+
+bool SolverCheckpoint::write(const string & path, const CheckpointState & state)
+{
+	CheckpointHeader h;
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, CHECKPOINT_MAGIC, sizeof(h.magic));
+	h.version = VERSION;
+	h.headerSize = sizeof(h);
+	h.imageWidth = state.imageSize.width;
+	h.imageHeight = state.imageSize.height;
+	h.imageType = state.imageType;
+	h.halfPatchWidth = state.halfPatchWidth;
+	h.nLevels = state.nLevels;
+	h.level = state.level;
+	h.iteration = state.iteration;
+	h.levelWidth = state.work.cols;
+	h.levelHeight = state.work.rows;
+	h.rngState = state.rngState;
+	h.anchorDiff = state.anchorDiff;
+	h.finished = state.finished ? 1 : 0;
+	h.sourceHash = state.sourceHash;
+	h.maskHash = state.maskHash;
+
+	h.workStep = state.work.cols * state.work.elemSize();
+	h.workOffset = alignSection(sizeof(h));
+	h.nnfStep = state.nnf.cols * state.nnf.elemSize();
+	h.nnfOffset = alignSection(h.workOffset + h.workStep * state.work.rows);
+	h.weightStep = state.weight.cols * state.weight.elemSize();
+	h.weightOffset = alignSection(h.nnfOffset + h.nnfStep * state.nnf.rows);
+	h.fileSize = h.weightOffset + h.weightStep * state.weight.rows;
+
+	string TempPath = path + ".tmp";
+	FILE * f = fopen(TempPath.c_str(), "wb");
+	if (!f)
+		return false;
+
+	uint64_t nPos = sizeof(h);
+	bool bOk = fwrite(&h, sizeof(h), 1, f) == 1
+		&& writeSection(f, nPos, h.workOffset, state.work)
+		&& writeSection(f, nPos, h.nnfOffset, state.nnf)
+		&& writeSection(f, nPos, h.weightOffset, state.weight);
+	bOk = fclose(f) == 0 && bOk;
+
+	// the previous checkpoint is only replaced by a complete one
+#ifdef _WIN32
+	bOk = bOk && MoveFileExA(TempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING);
+#else
+	bOk = bOk && rename(TempPath.c_str(), path.c_str()) == 0;
+#endif
+	if (!bOk)
+		remove(TempPath.c_str());
+	return bOk;
+}
+
+bool SolverCheckpoint::open(const string & path)
+{
+	close();
+
+#ifdef _WIN32
+	HANDLE hFile = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return false;
+	file = hFile;
+
+	LARGE_INTEGER nSize;
+	if (!GetFileSizeEx(hFile, &nSize) || nSize.QuadPart < (LONGLONG)sizeof(CheckpointHeader))
+	{
+		close();
+		return false;
+	}
+
+	mapping = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!mapping)
+	{
+		close();
+		return false;
+	}
+
+	view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	viewSize = (size_t)nSize.QuadPart;
+#else
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(CheckpointHeader))
+	{
+		::close(fd);
+		return false;
+	}
+
+	void * p = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (p != MAP_FAILED)
+	{
+		view = p;
+		viewSize = st.st_size;
+	}
+#endif
+	if (!view)
+	{
+		close();
+		return false;
+	}
+
+	const CheckpointHeader & h = *(const CheckpointHeader *)view;
+	int nLevelType = h.imageType;
+	bool bValid = memcmp(h.magic, CHECKPOINT_MAGIC, sizeof(h.magic)) == 0
+		&& h.version == VERSION
+		&& h.headerSize == sizeof(CheckpointHeader)
+		&& h.fileSize <= viewSize
+		&& CV_MAT_DEPTH(nLevelType) <= CV_16U
+		&& CV_MAT_CN(nLevelType) <= 4
+		&& sectionFits(h, h.workOffset, h.workStep, h.levelHeight, h.levelWidth, nLevelType)
+		&& sectionFits(h, h.nnfOffset, h.nnfStep, h.levelHeight, h.levelWidth, NNF_TYPE)
+		&& sectionFits(h, h.weightOffset, h.weightStep, h.imageHeight, h.imageWidth, CV_32F)
+		&& h.level >= 0 && h.level < h.nLevels && h.iteration >= 0;
+	if (!bValid)
+	{
+		close();
+		return false;
+	}
+
+	// read-only views straight into the mapping, nothing is copied
+	uchar * pBase = (uchar *)view;
+	state.imageSize = Size(h.imageWidth, h.imageHeight);
+	state.imageType = h.imageType;
+	state.halfPatchWidth = h.halfPatchWidth;
+	state.nLevels = h.nLevels;
+	state.level = h.level;
+	state.iteration = h.iteration;
+	state.anchorDiff = h.anchorDiff;
+	state.finished = h.finished != 0;
+	state.rngState = h.rngState;
+	state.sourceHash = h.sourceHash;
+	state.maskHash = h.maskHash;
+	state.work = Mat(h.levelHeight, h.levelWidth, h.imageType, pBase + h.workOffset, (size_t)h.workStep);
+	state.nnf = Mat(h.levelHeight, h.levelWidth, NNF_TYPE, pBase + h.nnfOffset, (size_t)h.nnfStep);
+	state.weight = Mat(h.imageHeight, h.imageWidth, CV_32F, pBase + h.weightOffset, (size_t)h.weightStep);
+	return true;
+}
+
+void SolverCheckpoint::close()
+{
+	state = CheckpointState();
+
+#ifdef _WIN32
+	if (view)
+		UnmapViewOfFile(view);
+	if (mapping)
+		CloseHandle(mapping);
+	if (file)
+		CloseHandle(file);
+	mapping = 0;
+	file = 0;
+#else
+	if (view)
+		munmap(view, viewSize);
+#endif
+	view = 0;
+	viewSize = 0;
+}
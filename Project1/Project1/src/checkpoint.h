@@ -0,0 +1,102 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+
+#include <opencv.hpp>
+#include <string>
+#include <stdint.h>
+
+// On-disk layout, native byte order. Every array starts on a 64 byte
+// boundary so a mapped file can be wrapped in cv::Mat headers as it is.
+struct CheckpointHeader
+{
+    char magic[8];              // "STCKPT" padded with zeros
+    uint32_t version;
+    uint32_t headerSize;
+    int32_t imageWidth;
+    int32_t imageHeight;
+    int32_t imageType;
+    int32_t halfPatchWidth;
+    int32_t nLevels;
+    int32_t level;              // pyramid level being solved
+    int32_t iteration;          // EM iterations already done at that level
+    int32_t levelWidth;
+    int32_t levelHeight;
+    uint64_t rngState;
+    float anchorDiff;           // change of the level's second iteration, or -1
+    uint32_t finished;          // 1 when level 0 completed, the solve's result
+    uint64_t sourceHash;        // SolverCheckpoint::hash of the full resolution
+    uint64_t maskHash;          // source image and hole mask
+    uint64_t workOffset, workStep;      // level image, imageType
+    uint64_t nnfOffset, nnfStep;        // level NNF, NNF_TYPE
+    uint64_t weightOffset, weightStep;  // full resolution weights, CV_32F
+    uint64_t fileSize;
+};
+
+// Solver state after one EM iteration, or of the completed solve.
+struct CheckpointState
+{
+    cv::Size imageSize;
+    int imageType;
+    int halfPatchWidth;
+    int nLevels;
+    int level;
+    int iteration;
+    float anchorDiff;
+    bool finished;
+    uint64_t rngState;
+    uint64_t sourceHash;
+    uint64_t maskHash;
+    cv::Mat work;
+    cv::Mat nnf;
+    cv::Mat weight;
+};
+
+// A checkpoint file mapped read-only. Loading validates the header and wraps
+// the arrays without parsing or copying them; the Mats of state point into
+// the mapping and stay valid until close().
+class SolverCheckpoint
+{
+public:
+    // 2: NNF distances are exact SSDs, header holds firstDiff and hashes
+    // 3: NnfEntry with a 64 bit distance
+    // 4: anchorDiff, of the second iteration, replaces firstDiff; finished
+    const static uint32_t VERSION=4;
+
+    SolverCheckpoint();
+    ~SolverCheckpoint();
+
+    bool open(const std::string & path);
+    void close();
+    bool isOpened() const;
+
+    // True when the checkpoint was taken by a solve of this image, mask and
+    // patch size, i.e. the solve can be resumed exactly. The hashes are those
+    // of hash() over the full resolution source and mask.
+    bool matches(cv::Size imageSize, int imageType, int halfPatchWidth,
+        uint64_t sourceHash, uint64_t maskHash) const;
+
+    // 64 bit FNV-1a of the size, type and pixels of m.
+    static uint64_t hash(const cv::Mat & m);
+
+    // Writes to a temporary file and renames it over path, so a crash while
+    // writing never destroys the previous checkpoint. On Windows this fails
+    // while an open SolverCheckpoint maps path.
+    static bool write(const std::string & path, const CheckpointState & state);
+
+    CheckpointState state;
+
+private:
+    SolverCheckpoint(const SolverCheckpoint &);
+    SolverCheckpoint & operator=(const SolverCheckpoint &);
+
+    void * view;
+    size_t viewSize;
+#ifdef _WIN32
+    void * file;
+    void * mapping;
+#endif
+};
+
+
+#endif // CHECKPOINT_H
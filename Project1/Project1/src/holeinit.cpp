@@ -0,0 +1,203 @@
+#include "holeinit.h"
+#include <vector>
+
+using namespace cv;
+using namespace std;
+
+// Same draw order as the solver always used, so seeded results do not move.
+template<typename T>
+static void fillNoise(Mat & work, const Mat & mask, RNG & rng, int nMaxValue)
+{
+	int cn = work.channels();
+	for (int i = 0; i < work.rows; i++)
+	{
+		T * pWork = work.ptr<T>(i);
+		const uchar * pMask = mask.ptr<uchar>(i);
+		for (int j = 0; j < work.cols; j++)
+		{
+			if (!pMask[j])
+				continue;
+			for (int c = 0; c < cn; c++)
+				pWork[j * cn + c] = (T)rng.uniform(0, nMaxValue);
+		}
+	}
+}
+
+// Every unknown pixel with a known 8-neighbour takes their mean, one ring per
+// pass, until the hole is closed. Color is CV_32FC(cn), Known CV_8U 0/1.
+static void onionPeel(Mat & Color, Mat & Known, Rect Box)
+{
+	int cn = Color.channels();
+	vector<Point> Ring;
+	vector<float> RingColor;
+
+	while (true)
+	{
+		Ring.clear();
+		RingColor.clear();
+		for (int i = Box.y; i < Box.y + Box.height; i++)
+		{
+			for (int j = Box.x; j < Box.x + Box.width; j++)
+			{
+				if (Known.at<uchar>(i, j))
+					continue;
+
+				float Sum[4] = { 0, 0, 0, 0 };
+				int nKnown = 0;
+				for (int y = max(i - 1, 0); y <= min(i + 1, Color.rows - 1); y++)
+				{
+					for (int x = max(j - 1, 0); x <= min(j + 1, Color.cols - 1); x++)
+					{
+						if (!Known.at<uchar>(y, x))
+							continue;
+						const float * p = Color.ptr<float>(y) + x * cn;
+						for (int c = 0; c < cn; c++)
+							Sum[c] += p[c];
+						nKnown++;
+					}
+				}
+				if (nKnown == 0)
+					continue;
+
+				Ring.push_back(Point(j, i));
+				for (int c = 0; c < cn; c++)
+					RingColor.push_back(Sum[c] / nKnown);
+			}
+		}
+
+		// nothing left, or nothing known to grow from
+		if (Ring.empty())
+			break;
+
+		for (size_t k = 0; k < Ring.size(); k++)
+		{
+			float * p = Color.ptr<float>(Ring[k].y) + Ring[k].x * cn;
+			for (int c = 0; c < cn; c++)
+				p[c] = RingColor[k * cn + c];
+			Known.at<uchar>(Ring[k]) = 1;
+		}
+	}
+}
+
+// Push: halve colour premultiplied by coverage, and the coverage, down to
+// 1x1. Pull: each level keeps what it knows and takes the rest, in
+// proportion to the missing coverage, from the level above.
+static void pushPull(Mat & Color, const Mat & Known)
+{
+	int cn = Color.channels();
+
+	vector<Mat> Premul(1), Weight(1);
+	Known.convertTo(Weight[0], CV_32F);
+	Premul[0].create(Color.size(), Color.type());
+	for (int i = 0; i < Color.rows; i++)
+	{
+		const float * pColor = Color.ptr<float>(i);
+		const float * pWeight = Weight[0].ptr<float>(i);
+		float * pPremul = Premul[0].ptr<float>(i);
+		for (int j = 0; j < Color.cols; j++)
+		{
+			for (int c = 0; c < cn; c++)
+				pPremul[j * cn + c] = pColor[j * cn + c] * pWeight[j];
+		}
+	}
+
+	while (Premul.back().cols > 1 || Premul.back().rows > 1)
+	{
+		Size Half((Premul.back().cols + 1) / 2, (Premul.back().rows + 1) / 2);
+		Premul.push_back(Mat());
+		Weight.push_back(Mat());
+		resize(Premul[Premul.size() - 2], Premul.back(), Half, 0, 0, INTER_AREA);
+		resize(Weight[Weight.size() - 2], Weight.back(), Half, 0, 0, INTER_AREA);
+	}
+
+	// colour of the 1x1 top
+	Mat Filled = Premul.back().clone();
+	float fTop = Weight.back().at<float>(0, 0);
+	Filled = fTop > 0 ? Filled / fTop : Mat::zeros(Filled.size(), Filled.type());
+
+	for (int n = (int)Premul.size() - 2; n >= 0; n--)
+	{
+		Mat Up;
+		resize(Filled, Up, Premul[n].size(), 0, 0, INTER_LINEAR);
+		Filled.create(Premul[n].size(), Premul[n].type());
+		for (int i = 0; i < Filled.rows; i++)
+		{
+			const float * pPremul = Premul[n].ptr<float>(i);
+			const float * pWeight = Weight[n].ptr<float>(i);
+			const float * pUp = Up.ptr<float>(i);
+			float * pFilled = Filled.ptr<float>(i);
+			for (int j = 0; j < Filled.cols; j++)
+			{
+				float fMissing = 1 - min(pWeight[j], 1.0f);
+				for (int c = 0; c < cn; c++)
+					pFilled[j * cn + c] = pPremul[j * cn + c] + fMissing * pUp[j * cn + c];
+			}
+		}
+	}
+
+	Color = Filled;
+}
+
+void initializeHole(Mat & work, const Mat & mask, HoleInit method, RNG & rng, int valueRange)
+{
+	if (method == HOLE_INIT_NOISE)
+	{
+		if (work.depth() == CV_16U)
+			fillNoise<ushort>(work, mask, rng, valueRange);
+		else
+			fillNoise<uchar>(work, mask, rng, valueRange);
+		return;
+	}
+
+	// cv::inpaint takes 8 bit gray or BGR and 16 bit gray only
+	int nType = work.type();
+	if (method == HOLE_INIT_TELEA && (nType == CV_8UC1 || nType == CV_8UC3 || nType == CV_16UC1))
+	{
+		Mat Filled;
+		inpaint(work, mask, Filled, 3, INPAINT_TELEA);
+		Filled.copyTo(work, mask);
+		return;
+	}
+
+	Mat Color, Known;
+	work.convertTo(Color, CV_32F);
+	threshold(mask, Known, 0, 1, THRESH_BINARY_INV);
+
+	if (method == HOLE_INIT_PUSH_PULL)
+		pushPull(Color, Known);
+	else
+		onionPeel(Color, Known, boundingRect(mask));
+
+	Mat Filled;
+	Color.convertTo(Filled, work.type());
+	Filled.copyTo(work, mask);
+}
+
+const char * holeInitName(HoleInit method)
+{
+	switch (method)
+	{
+	case HOLE_INIT_PUSH_PULL:
+		return "pushpull";
+	case HOLE_INIT_ONION_PEEL:
+		return "onion";
+	case HOLE_INIT_TELEA:
+		return "telea";
+	default:
+		return "noise";
+	}
+}
+
+bool parseHoleInit(const string & name, HoleInit & method)
+{
+	const HoleInit Methods[] = { HOLE_INIT_NOISE, HOLE_INIT_PUSH_PULL, HOLE_INIT_ONION_PEEL, HOLE_INIT_TELEA };
+	for (int n = 0; n < 4; n++)
+	{
+		if (name == holeInitName(Methods[n]))
+		{
+			method = Methods[n];
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,29 @@
+#ifndef HOLEINIT_H
+#define HOLEINIT_H
+
+
+#include <opencv.hpp>
+#include <string>
+
+// How the hole of the coarsest level is filled before the first EM
+// iteration. Anything but noise gives PatchMatch structure to latch on to
+// and saves iterations there; see the level report.
+enum HoleInit
+{
+    HOLE_INIT_NOISE,        // uniform random colours
+    HOLE_INIT_PUSH_PULL,    // premultiplied pyramid down, then back up
+    HOLE_INIT_ONION_PEEL,   // ring by ring from the boundary inward
+    HOLE_INIT_TELEA         // cv::inpaint; onion peel for types it lacks
+};
+
+// Overwrites the non-zero pixels of mask in work (8 or 16 bit, 1, 3 or 4
+// channels) from the pixels outside it. rng is only drawn from for noise,
+// which stays below valueRange, the brightest value the data can hold.
+void initializeHole(cv::Mat & work, const cv::Mat & mask, HoleInit method, cv::RNG & rng, int valueRange);
+
+// "noise", "pushpull", "onion", "telea"
+const char * holeInitName(HoleInit method);
+bool parseHoleInit(const std::string & name, HoleInit & method);
+
+
+#endif // HOLEINIT_H
@@ -0,0 +1,116 @@
+#include "inpaintapi.h"
+#include "inpainter.h"
+#include <atomic>
+#include <new>
+#include <string>
+
+using namespace cv;
+using namespace std;
+
+struct InpaintContext
+{
+	InpaintWorkspace workspace;
+	InpaintOptions options;
+	atomic<bool> cancel;
+	string error;
+};
+
+static int formatType(int format)
+{
+	switch (format)
+	{
+	case INPAINT_GRAY8:
+		return CV_8UC1;
+	case INPAINT_BGR8:
+		return CV_8UC3;
+	case INPAINT_BGRA8:
+		return CV_8UC4;
+	case INPAINT_GRAY16:
+		return CV_16UC1;
+	case INPAINT_BGR16:
+		return CV_16UC3;
+	case INPAINT_BGRA16:
+		return CV_16UC4;
+	default:
+		return -1;
+	}
+}
+
+// A header over the caller's pixels, no copy; false when image does not
+// describe a buffer of that type.
+static bool wrapImage(const InpaintImage * image, int type, Mat & header)
+{
+	if (!image->data || image->width <= 0 || image->height <= 0)
+		return false;
+	if (image->stride < (size_t)image->width * CV_ELEM_SIZE(type) || image->stride % CV_ELEM_SIZE1(type))
+		return false;
+
+	header = Mat(image->height, image->width, type, image->data, image->stride);
+	return true;
+}
+
+InpaintContext * inpaint_create(void)
+{
+	InpaintContext * ctx = new (nothrow) InpaintContext();
+	if (ctx)
+		ctx->cancel = false;
+	return ctx;
+}
+
+void inpaint_destroy(InpaintContext * ctx)
+{
+	delete ctx;
+}
+
+int inpaint_solve(InpaintContext * ctx, const InpaintImage * input,
+	const InpaintImage * mask, const InpaintImage * output, int halfPatchWidth)
+{
+	if (!ctx || !input || !mask || !output)
+		return INPAINT_ERROR_ARGUMENT;
+	ctx->error.clear();
+	ctx->cancel = false;
+
+	int nType = formatType(input->format);
+	if (nType < 0 || mask->format != INPAINT_GRAY8 || output->format != input->format)
+		return INPAINT_ERROR_FORMAT;
+
+	try
+	{
+		Mat Image, Mask, Output;
+		if (!wrapImage(input, nType, Image) || !wrapImage(mask, CV_8UC1, Mask) || !wrapImage(output, nType, Output))
+			return INPAINT_ERROR_ARGUMENT;
+		if (Mask.size() != Image.size() || Output.size() != Image.size())
+			return INPAINT_ERROR_ARGUMENT;
+		if (halfPatchWidth <= 0)
+			return INPAINT_ERROR_ARGUMENT;
+		if (!Inpainter::patchFits(Image.size(), halfPatchWidth))
+			return INPAINT_ERROR_TOO_SMALL;
+
+		// the pyramid only borrows level 0, the solver keeps its own work image
+		ctx->options.cancel = &ctx->cancel;
+		ctx->workspace.pyramid.build(Image, ctx->options.schedule.maxLevels, true);
+		bool bSolved = inpaintHoleInto(ctx->workspace.pyramid, Mask, halfPatchWidth, ctx->options,
+			ctx->workspace, Output);
+		return bSolved ? INPAINT_OK : INPAINT_CANCELLED;
+	}
+	catch (const std::exception & e)
+	{
+		ctx->error = e.what();
+	}
+	catch (...)
+	{
+		ctx->error = "unknown error";
+	}
+	return INPAINT_ERROR_INTERNAL;
+}
+
+void inpaint_cancel(InpaintContext * ctx)
+{
+	if (ctx)
+		ctx->cancel = true;
+}
+
+const char * inpaint_last_error(const InpaintContext * ctx)
+{
+	return ctx ? ctx->error.c_str() : "";
+}
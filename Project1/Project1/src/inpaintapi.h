@@ -0,0 +1,81 @@
+#ifndef INPAINTAPI_H
+#define INPAINTAPI_H
+
+
+#include <stddef.h>
+
+// Plain C entry point for embedding the solver in other programs. Images stay
+// in the caller's buffers: the source is read where it lies and the solve
+// writes nothing but the hole pixels of the output. No call throws, and no
+// C++ type crosses the boundary.
+
+#if defined(_WIN32) && defined(INPAINT_EXPORTS)
+#define INPAINT_API __declspec(dllexport)
+#else
+#define INPAINT_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Interleaved channels in OpenCV order.
+enum InpaintFormat
+{
+    INPAINT_GRAY8 = 1,
+    INPAINT_BGR8 = 2,
+    INPAINT_BGRA8 = 3,
+    INPAINT_GRAY16 = 4,
+    INPAINT_BGR16 = 5,
+    INPAINT_BGRA16 = 6
+};
+
+enum InpaintStatus
+{
+    INPAINT_OK = 0,
+    INPAINT_CANCELLED = 1,          // inpaint_cancel stopped the solve
+    INPAINT_ERROR_ARGUMENT = -1,    // null pointer, size, stride or patch width
+    INPAINT_ERROR_FORMAT = -2,      // unknown format, or formats that differ
+    INPAINT_ERROR_INTERNAL = -3,    // the solver failed, see inpaint_last_error
+    INPAINT_ERROR_TOO_SMALL = -4    // the smaller side is under 4 * halfPatchWidth + 2
+};
+
+// A caller-owned image. stride is the distance in bytes from one row to the
+// next; it may exceed the row, but must be a multiple of the channel size.
+typedef struct InpaintImage
+{
+    void * data;
+    int width;
+    int height;
+    size_t stride;
+    int format;                     // InpaintFormat
+} InpaintImage;
+
+// Holds the solver buffers, so a context reused across calls on images of one
+// size allocates nothing after the first. One solve per context at a time.
+typedef struct InpaintContext InpaintContext;
+
+INPAINT_API InpaintContext * inpaint_create(void);
+INPAINT_API void inpaint_destroy(InpaintContext * ctx);
+
+// Fills the non-zero pixels of mask (INPAINT_GRAY8, the size of input) and
+// writes them into output, which has the size and format of input. Every
+// other output pixel is left as it is, so output may be input itself for an
+// in-place solve, or a separate buffer that already holds the picture.
+// input must not change until the call returns. Returns an InpaintStatus.
+INPAINT_API int inpaint_solve(InpaintContext * ctx, const InpaintImage * input,
+    const InpaintImage * mask, const InpaintImage * output, int halfPatchWidth);
+
+// Stops the solve running on ctx soon after; safe from any thread. The next
+// inpaint_solve starts afresh.
+INPAINT_API void inpaint_cancel(InpaintContext * ctx);
+
+// Message of the last INPAINT_ERROR_INTERNAL on ctx, empty otherwise.
+INPAINT_API const char * inpaint_last_error(const InpaintContext * ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif // INPAINTAPI_H
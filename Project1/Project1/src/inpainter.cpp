@@ -1,306 +1,666 @@
-/*M///////////////////////////////////////////////////////////////////////////////////////
-//
-//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
-//
-//  By downloading, copying, installing or using the software you agree to this license.
-//  If you do not agree to this license, do not download, install,
-//  copy or use the software.
-//
-//
-//                           License Agreement
-//                For Open Source Computer Vision Library
-//
-// Copyright (C) 2000-2008, Intel Corporation, all rights reserved.
-// Copyright (C) 2008-2012, Willow Garage Inc., all rights reserved.
-// Third party copyrights are property of their respective owners.
-//
-// Redistribution and use in source and binary forms, with or without modification,
-// are permitted provided that the following conditions are met:
-//
-//   * Redistribution's of source code must retain the above copyright notice,
-//     this list of conditions and the following disclaimer.
-//
-//   * Redistribution's in binary form must reproduce the above copyright notice,
-//     this list of conditions and the following disclaimer in the documentation
-//     and/or other materials provided with the distribution.
-//
-//   * The name of the copyright holders may not be used to endorse or promote products
-//     derived from this software without specific prior written permission.
-//
-// This software is provided by the copyright holders and contributors "as is" and
-// any express or implied warranties, including, but not limited to, the implied
-// warranties of merchantability and fitness for a particular purpose are disclaimed.
-// In no event shall the Intel Corporation or contributors be liable for any direct,
-// indirect, incidental, special, exemplary, or consequential damages
-// (including, but not limited to, procurement of substitute goods or services;
-// loss of use, data, or profits; or business interruption) however caused
-// and on any theory of liability, whether in contract, strict liability,
-// or tort (including negligence or otherwise) arising in any way out of
-// the use of this software, even if advised of the possibility of such damage.
-//
-//M*/
-
-#include "inpainter.h"
-#include <opencv.hpp>
-#include <opencv2/core.hpp>
-#include <opencv2/highgui/highgui.hpp>
-#include <opencv2/core/types_c.h>
-#include <vector>
-
-using namespace cv;
-using namespace std;
-
-Inpainter::Inpainter(cv::Mat inputImage,cv::Mat mask,int halfPatchWidth,int mode)
-{
-    this->inputImage=inputImage.clone();
-    this->mask=mask.clone();
-    this->workImage=inputImage.clone();
-    this->result.create(inputImage.size(),inputImage.type());
-    this->halfPatchWidth=halfPatchWidth;
-}
-
-int Inpainter::checkValidInputs(){
-    if(this->inputImage.type()!=CV_8UC3)
-        return ERROR_INPUT_MAT_INVALID_TYPE;
-    if(this->mask.type()!=CV_8UC1)
-        return ERROR_INPUT_MASK_INVALID_TYPE;
-    if(!CV_ARE_SIZES_EQ(&mask,&inputImage))
-        return ERROR_MASK_INPUT_SIZE_MISMATCH;
-    if(halfPatchWidth==0)
-        return ERROR_HALF_PATCH_WIDTH_ZERO;
-    return CHECK_VALID;
-}
-
-
-void PatchMatch(const Mat & SourceImage, const Mat & TargetImage, const Mat & Mask, int nPatchSize, Mat & NearestNeighbor);
-Vec3f MeanShift(vector<Vec3b> vecVoteColor, vector<float> vecVoteWeight, int sigma);
-
-void Inpainter::inpaint(cv::VideoWriter & video)
-{
-	Mat Weight = Mat(workImage.size(), CV_32F);
-	distanceTransform(mask, Weight, CV_DIST_L2, 3);
-
-	// ȽmaskΪϢ
-	for (int i =0; i < workImage.rows; i++)
-	{
-		for (int j = 0; j < workImage.cols; j++)
-		{
-			float dist = Weight.at<float>(i, j);
-			Weight.at<float>(i, j) = (float)pow(1.3,  -dist);
-
-			if (mask.at<uchar>(i,j))
-			{
-				inputImage.at<Vec3b>(i,j)[0] = rand() % 255;
-				inputImage.at<Vec3b>(i, j)[1] = rand() % 255;
-				inputImage.at<Vec3b>(i, j)[2] = rand() % 255;
-			}
-		}
-	}
-
-
-
-
-	// ͬĳ߶
-	int nPyrmidNum = 3;
-	Mat CurWork = Mat();
-	Mat CurMask;
-	Mat CurWeight;
-	int PatchSize = 2 * halfPatchWidth + 1;
-	while (nPyrmidNum >= 0)
-	{
-		// ײ
-		float scale = 1.0 / (1 << nPyrmidNum);
-		resize(inputImage, workImage, Size(inputImage.cols * scale, scale * inputImage.rows));
-		resize(mask, CurMask, Size(mask.cols * scale, scale * mask.rows));
-		resize(Weight, CurWeight, Size(Weight.cols * scale, scale * Weight.rows));
-
-		if (CurWork.cols > 0) // ѾͼƬ
-		{
-			resize(CurWork, CurWork, Size(inputImage.cols * scale, scale * inputImage.rows));
-			// maskһε
-			for (int i = 0; i < CurWork.rows; i++)
-			{
-				for (int j = 0; j< CurWork.cols; j++)
-				{
-					if (CurMask.at<uchar>(i,j) == 0)
-					{
-						CurWork.at<Vec3b>(i,j) = workImage.at<Vec3b>(i,j);
-					}
-				}
-			}
-		}
-		else
-		{
-			CurWork = workImage.clone();
-		}
-		
-		int nIterMaxNum = 30;
-
-		int minLen = min(CurWork.rows, CurWork.cols);
-
-		if (minLen < 2 * PatchSize)
-		{
-			nPyrmidNum--;
-			continue;
-		}
-		
-		// ѭֱ
-		while (true)
-		{
-			Mat LastImage = CurWork.clone();
-
-			Mat OutPutFrame;
-			resize(CurWork, OutPutFrame, Size(inputImage.cols, inputImage.rows));
-
-
-			video << OutPutFrame;
-
-			// patchMatch patch
-			Mat NNF;
-			PatchMatch(CurWork, CurWork, CurMask, PatchSize, NNF);
-
-			// ѭͼƬ
-			for (int i = 0; i < CurWork.rows; i++)
-			{
-				for (int j =0; j < CurWork.cols; j++)
-				{
-					//Ҫ
-					if (CurMask.at<uchar>(i,j))
-					{
-
-						vector<Vec3b> vecVoteColor;
-						vector<float> vecVoteWeight;
-						vector<float> vecDist;
-
-						// оõpatch
-						for (int k = -PatchSize + 1; k <= 0; k++)
-						{
-							for (int m = -PatchSize + 1; m <= 0; m++)
-							{
-								int nPosY = i + k;
-								int nPosX = j + m;
-
-								// patch컹ͼΧ
-								if (nPosY < 0 
-									|| nPosX < 0
-									|| nPosX + PatchSize >= CurWork.cols -1
-									|| nPosY + PatchSize >= CurWork.rows - 1)
-									continue;
-
-								Rect sTCurPatchRect(nPosX, nPosY, PatchSize, PatchSize);  // ǰ
-								Mat CurPatch = CurWork(sTCurPatchRect);
-
-								int NNF_X = NNF.at<Vec3i>(nPosY, nPosX)[0];
-								int NNF_Y = NNF.at<Vec3i>(nPosY, nPosX)[1];
-
-								Rect NearPatchRect(NNF_X, NNF_Y, PatchSize, PatchSize);  // ǰ
-								Mat NearestPatch = CurWork(NearPatchRect);
-
-
-								// patch֮ľ
-								int dist = norm(CurPatch, NearestPatch);
-
-								// ĳɫͶƱ
-								Vec3b VoteColor = NearestPatch.at<Vec3b>(-k, -m);
-
-								// Ȩ
-								float fWeight = Weight.at<float>(nPosY + PatchSize / 2, nPosX + PatchSize / 2);
-
-								vecDist.push_back(dist * dist);
-								vecVoteColor.push_back(VoteColor);
-								vecVoteWeight.push_back(fWeight);
-							}
-						}
-
-						if (vecVoteWeight.size() < 3)
-						{
-							continue;
-						}
-						// һ
-						vector<float> vecDistCopy;
-						vecDistCopy.assign(vecDist.begin(), vecDist.end());//v2ֵv1
-
-						// 
-						sort(vecDistCopy.begin(), vecDistCopy.end());
-
-						int nId = vecDistCopy.size() * 3 / 4;
-						float nSigma = vecDistCopy[nId];
-
-						// Ȩ
-						for (int i =0 ; i < vecVoteWeight.size(); i++)
-						{
-							// sigmaΪ0
-							if(nSigma != 0)
-								vecVoteWeight[i] = vecVoteWeight[i] * exp(-(vecDist[i]) / (2 * nSigma));
-						}
-
-						float nMax = 0;
-						for (int i = 0; i < vecVoteWeight.size(); i++)
-						{
-							if (nMax < vecVoteWeight[i])
-							{
-								nMax = vecVoteWeight[i];
-							}
-						}
-						// һ,ȨعС
-						for (int i = 0; i < vecVoteWeight.size(); i++)
-						{
-							vecVoteWeight[i] = vecVoteWeight[i] / nMax;
-						}
-
-
-						CurWork.at<Vec3b>(i,j)  = MeanShift(vecVoteColor, vecVoteWeight, 50);
-						
-					}
-				}
-			}
-			nIterMaxNum--;
-
-
-		
-
-			if (nIterMaxNum <= 0)
-			{
-				break;
-			}
-
-			float diff = 0;
-			int Num = 0;
-			for (int i = 0; i < LastImage.rows; i++)
-			{
-				for (int j = 0; j < LastImage.cols; j++)
-				{
-					if (CurMask.at<uchar>(i, j))
-					{
-						Vec3f a1 = LastImage.at<Vec3b>(i, j);
-						Vec3f a2 = CurWork.at<Vec3b>(i, j);
-						Vec3f a3 = a1 - a2;
-						
-						diff += a3[0] * a3[0] + a3[1] * a3[1] + a3[2] * a3[2];
-
-						Num++;
-					}
-
-				}
-			}
-
-			diff = diff / Num;
-
-			imshow("CurWork", CurWork);
-			cvWaitKey(100);
-
-			printf("scale: %f, dff: %f\n", scale, diff);
-		
-			if (diff < 100)
-			{
-				break;
-			}
-
-		}
-
-		// һ㣬һ
-		nPyrmidNum--;
-	}
-
-	result = CurWork;
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//                For Open Source Computer Vision Library
+//
+// Copyright (C) 2000-2008, Intel Corporation, all rights reserved.
+// Copyright (C) 2008-2012, Willow Garage Inc., all rights reserved.
+// Third party copyrights are property of their respective owners.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+//   * Redistribution's of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//
+//   * Redistribution's in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//   * The name of the copyright holders may not be used to endorse or promote products
+//     derived from this software without specific prior written permission.
+//
+// This software is provided by the copyright holders and contributors "as is" and
+// any express or implied warranties, including, but not limited to, the implied
+// warranties of merchantability and fitness for a particular purpose are disclaimed.
+// In no event shall the Intel Corporation or contributors be liable for any direct,
+// indirect, incidental, special, exemplary, or consequential damages
+// (including, but not limited to, procurement of substitute goods or services;
+// loss of use, data, or profits; or business interruption) however caused
+// and on any theory of liability, whether in contract, strict liability,
+// or tort (including negligence or otherwise) arising in any way out of
+// the use of this software, even if advised of the possibility of such damage.
+//
+//M*/
+
+#include "inpainter.h"
+#include <opencv.hpp>
+#include <opencv2/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/core/types_c.h>
+#include <limits>
+#include <vector>
+
+using namespace cv;
+using namespace std;
+
+Inpainter::Inpainter(cv::Mat inputImage,cv::Mat mask,int halfPatchWidth,int mode)
+{
+    this->inputImage=inputImage.clone();
+    this->mask=mask.clone();
+    this->workImage=inputImage.clone();
+    this->result.create(inputImage.size(),inputImage.type());
+    this->halfPatchWidth=halfPatchWidth;
+}
+
+bool Inpainter::supportsType(int type){
+    int depth=CV_MAT_DEPTH(type), cn=CV_MAT_CN(type);
+    return (depth==CV_8U || depth==CV_16U) && (cn==1 || cn==3 || cn==4);
+}
+
+bool Inpainter::patchFits(cv::Size imageSize, int halfPatchWidth){
+    return min(imageSize.width,imageSize.height)>=2*(2*halfPatchWidth+1);
+}
+
+int Inpainter::checkValidInputs(){
+    return checkInputs(inputImage,mask,halfPatchWidth,options);
+}
+
+int Inpainter::checkInputs(const cv::Mat & image,const cv::Mat & mask,int halfPatchWidth,const InpaintOptions & options){
+    if(!supportsType(image.type()))
+        return ERROR_INPUT_MAT_INVALID_TYPE;
+    if(mask.type()!=CV_8UC1)
+        return ERROR_INPUT_MASK_INVALID_TYPE;
+    if(mask.size()!=image.size())
+        return ERROR_MASK_INPUT_SIZE_MISMATCH;
+    if(!options.excludeFromSource.empty() && options.excludeFromSource.type()!=CV_8UC1)
+        return ERROR_INPUT_MASK_INVALID_TYPE;
+    if(!options.excludeFromSource.empty() && options.excludeFromSource.size()!=image.size())
+        return ERROR_MASK_INPUT_SIZE_MISMATCH;
+    if(halfPatchWidth<=0)
+        return ERROR_HALF_PATCH_WIDTH_ZERO;
+    if(!patchFits(image.size(),halfPatchWidth))
+        return ERROR_IMAGE_TOO_SMALL;
+    if(!options.schedule.valid())
+        return ERROR_INVALID_SCHEDULE;
+    if(options.resumeFrom && !options.resumeFrom->matches(image.size(),image.type(),halfPatchWidth,
+        SolverCheckpoint::hash(image),SolverCheckpoint::hash(mask)))
+        return ERROR_CHECKPOINT_MISMATCH;
+    return CHECK_VALID;
+}
+
+InpaintOptions::InpaintOptions()
+{
+    checkpointSeconds=60;
+    resumeFrom=0;
+    warmStartFrom=0;
+    cancel=0;
+    holeInit=HOLE_INIT_NOISE;
+}
+
+
+template<typename T, int cn>
+bool PatchMatch(const Mat & SourceImage, const Mat & TargetImage, const Mat & PatchHoles, int nPatchSize, Mat & NearestNeighbor, RNG & rng, Rect Region, bool bWarmStart,
+	int nSweeps, const std::atomic<bool> * pCancel);
+template<typename T, int cn>
+bool ExactNNF(const Mat & Image, const Mat & PatchHoles, int nPatchSize, Mat & NearestNeighbor, Rect Region,
+	ExactNNFBuffers & Scratch, const std::atomic<bool> * pCancel);
+void UpsampleNNF(const Mat & CoarseNNF, Rect CoarseRegion, Mat & FineNNF, Rect Region, int nPatchSize, RNG & rng);
+template<typename T, int cn>
+int64 PatchSSD(const Mat & ImageA, int ax, int ay, const Mat & ImageB, int bx, int by, int PatchSize);
+template<int cn>
+Vec<float, cn> MeanShift(const vector<float> & vecVoteColor, const vector<float> & vecVoteWeight, float sigma);
+
+void Inpainter::inpaint(cv::VideoWriter & video)
+{
+	InpaintWorkspace workspace;
+	inpaint(video, workspace);
+}
+
+void Inpainter::inpaint(cv::VideoWriter & video, InpaintWorkspace & ws)
+{
+	ws.pyramid.build(inputImage, options.schedule.maxLevels);
+	inpaintHole(ws.pyramid, mask, halfPatchWidth, options, ws, result, &video);
+}
+
+static inline bool cancelled(const InpaintOptions & options)
+{
+	return options.cancel && options.cancel->load(std::memory_order_relaxed);
+}
+
+// Range of the values image holds: 255 for 8 bit, and for 16 bit the
+// smallest 2^n - 1 at or above its brightest sample, so 12 bit data stored
+// in 16 bit words gets 4095 rather than 65535.
+static int valueRange(const Mat & image)
+{
+	if (image.depth() != CV_16U)
+		return 255;
+
+	double fMax = 0;
+	minMaxLoc(image.reshape(1), 0, &fMax);
+	int nRange = 255;
+	while (nRange < fMax)
+		nRange = nRange * 2 + 1;
+	return nRange;
+}
+
+// Copies the state of checkpoint out of its mapping; the saved weights go
+// into weight, which has to have the image size already, when it is not empty.
+static void takeState(const SolverCheckpoint & checkpoint, CheckpointState & state, Mat weight)
+{
+	state = checkpoint.state;
+	state.work = checkpoint.state.work.clone();
+	state.nnf = checkpoint.state.nnf.clone();
+	state.weight = Mat();
+	if (!weight.empty())
+		checkpoint.state.weight.copyTo(weight);
+}
+
+// The solver for one pixel type; inpaintHole picks the instantiation.
+// bHoleOnly writes just the pixels under mask into result, which then has to
+// have the image size and type already.
+template<typename T, int cn>
+static bool solveHole(const SourcePyramid & pyramid, const Mat & mask, int halfPatchWidth,
+	const InpaintOptions & options, InpaintWorkspace & ws, Mat & result, VideoWriter * video, bool bHoleOnly)
+{
+	typedef Vec<T, cn> Pixel;
+
+	int PatchSize = 2 * halfPatchWidth + 1;
+	Size ImageSize = pyramid.level(0).size();
+	int nImageType = pyramid.level(0).type();
+
+	// colour distances and thresholds are tuned for 8 bit; deeper images
+	// scale them by their value range over 255 (squared ones by its square)
+	const int nValueRange = valueRange(pyramid.level(0));
+	const float fRangeScale = nValueRange / 255.0f;
+
+	// checkpoints only apply to the very image and hole they were taken of
+	uint64_t nSourceHash = 0, nMaskHash = 0;
+	if (options.resumeFrom || options.warmStartFrom || !options.checkpointPath.empty())
+	{
+		nSourceHash = SolverCheckpoint::hash(pyramid.level(0));
+		nMaskHash = SolverCheckpoint::hash(mask);
+	}
+
+	ws.weight.create(ImageSize, CV_32F);
+	Mat Weight = ws.weight;
+
+	CheckpointState Saved;
+	const CheckpointState * Resume = 0;
+	if (options.resumeFrom && options.resumeFrom->matches(ImageSize, nImageType, halfPatchWidth, nSourceHash, nMaskHash)
+		&& options.resumeFrom->state.nLevels <= pyramid.levelCount())
+	{
+		takeState(*options.resumeFrom, Saved, Weight);
+		Resume = &Saved;
+	}
+
+	const CheckpointState * WarmStart = 0;
+	if (!Resume && options.warmStartFrom && options.warmStartFrom->isOpened()
+		&& options.warmStartFrom->state.imageSize == ImageSize
+		&& options.warmStartFrom->state.imageType == nImageType
+		&& options.warmStartFrom->state.sourceHash == nSourceHash)
+	{
+		takeState(*options.warmStartFrom, Saved, Mat());
+		WarmStart = &Saved;
+	}
+
+	// nothing of a mapping is read from here on; drop them so the
+	// checkpoints below can replace their files
+	if (!options.checkpointPath.empty())
+	{
+		if (options.resumeFrom)
+			options.resumeFrom->close();
+		if (options.warmStartFrom)
+			options.warmStartFrom->close();
+	}
+
+	int nLevels;
+	if (Resume)
+		nLevels = Resume->nLevels;
+	else
+	{
+		distanceTransform(mask, Weight, CV_DIST_L2, 3);
+
+		float fMaxDist = 0;
+		for (int i =0; i < Weight.rows; i++)
+		{
+			for (int j = 0; j < Weight.cols; j++)
+			{
+				float dist = Weight.at<float>(i, j);
+				fMaxDist = max(fMaxDist, dist);
+				Weight.at<float>(i, j) = (float)pow(1.3,  -dist);
+			}
+		}
+
+		nLevels = min(options.schedule.levels(ImageSize, 2 * fMaxDist, PatchSize), pyramid.levelCount());
+	}
+
+	// 多个不同的尺度
+	// a warm start from a level this solve has begins right there
+	int nPyrmidNum = nLevels - 1;
+	if (Resume)
+		nPyrmidNum = Resume->level;
+	else if (WarmStart && WarmStart->level < nLevels)
+		nPyrmidNum = WarmStart->level;
+
+	ws.prepare(ImageSize, nImageType, nLevels, PatchSize, options.schedule.exactNNFPixels);
+	ws.report.clear();
+	ws.checkpointFailures = 0;
+	if (Resume)
+		ws.rng.state = Resume->rngState;
+
+	int64 nLastCheckpoint = getTickCount();
+
+
+
+
+	int nLastLevel = -1;
+	// the last level that ran PatchMatch, whose NNF seeds the next one
+	int nNNFLevel = -1;
+	Rect NNFRegion;
+	while (nPyrmidNum >= 0)
+	{
+		if (cancelled(options))
+			return false;
+
+		// 最底层的
+		float scale = 1.0 / (1 << nPyrmidNum);
+		LevelBuffers & lvl = ws.level(nPyrmidNum);
+		Size LevelSize = SourcePyramid::levelSize(ImageSize, nPyrmidNum);
+
+		int minLen = min(LevelSize.width, LevelSize.height);
+
+		if (minLen < 2 * PatchSize)
+		{
+			nPyrmidNum--;
+			continue;
+		}
+
+		const Mat & Source = pyramid.level(nPyrmidNum);
+		Mat & CurWork = lvl.work;
+		Mat & CurMask = lvl.mask;
+		Mat & LastImage = lvl.last;
+		Mat & NNF = lvl.nnf;
+
+		resize(mask, CurMask, LevelSize);
+		resize(Weight, lvl.weight, LevelSize);
+
+		// hole (and excluded) pixels under every patch, for the PatchMatch candidate test
+		threshold(CurMask, CurMask, 0, 255, THRESH_BINARY);
+		const Mat * pNoSource = &CurMask;
+		if (!options.excludeFromSource.empty())
+		{
+			resize(options.excludeFromSource, lvl.excluded, LevelSize);
+			threshold(lvl.excluded, lvl.excluded, 0, 255, THRESH_BINARY);
+			bitwise_or(lvl.excluded, CurMask, lvl.excluded);
+			pNoSource = &lvl.excluded;
+		}
+		boxFilter(*pNoSource, lvl.patchHoles, CV_32S, Size(PatchSize, PatchSize), Point(0, 0), false);
+
+		// entries outside HoleRegion are never matched; zero keeps checkpoints
+		// of the NNF deterministic
+		NNF.setTo(Scalar::all(0));
+
+		bool bSeedNNF = false;
+		bool bWarmNNF = false;
+		// resumed from the final checkpoint: the level is already solved
+		bool bLevelSolved = false;
+		int nDoneIterations = 0;
+		// the relative test is anchored on the change of the level's second
+		// iteration; the first mostly measures how far the initial fill was off
+		float fAnchorDiff = -1;
+		if (nLastLevel >= 0) // 如果已经有图片了
+		{
+			resize(ws.level(nLastLevel).work, CurWork, LevelSize);
+		}
+		else if (Resume)
+		{
+			Resume->work.copyTo(CurWork);
+			Resume->nnf.copyTo(NNF);
+			bSeedNNF = true;
+			nDoneIterations = Resume->iteration;
+			fAnchorDiff = Resume->anchorDiff;
+			bLevelSolved = Resume->finished;
+		}
+		else if (WarmStart)
+		{
+			resize(WarmStart->work, CurWork, LevelSize);
+			bWarmNNF = WarmStart->halfPatchWidth == halfPatchWidth;
+		}
+		else
+		{
+			Source.copyTo(CurWork);
+		}
+
+		// mask外的区域用上一次的数据填充
+		// 先将mask区域设置为随机，表明该区域无信息
+		Point HoleMin(CurWork.cols, CurWork.rows), HoleMax(-1, -1);
+		for (int i = 0; i < CurWork.rows; i++)
+		{
+			for (int j = 0; j< CurWork.cols; j++)
+			{
+				if (CurMask.at<uchar>(i,j) == 0)
+				{
+					CurWork.at<Pixel>(i,j) = Source.at<Pixel>(i,j);
+					continue;
+				}
+
+				HoleMin = Point(min(HoleMin.x, j), min(HoleMin.y, i));
+				HoleMax = Point(max(HoleMax.x, j), max(HoleMax.y, i));
+			}
+		}
+
+		// the coarsest level has nothing to upsample, start from options.holeInit
+		if (nLastLevel < 0 && !Resume && !WarmStart && HoleMax.x >= 0)
+			initializeHole(CurWork, CurMask, options.holeInit, ws.rng, nValueRange);
+
+		nLastLevel = nPyrmidNum;
+
+		// the hole vanished at this scale, nothing to solve
+		if (HoleMax.x < 0)
+		{
+			nPyrmidNum--;
+			continue;
+		}
+
+		// every patch that covers a hole pixel, i.e. all NNF entries voting uses
+		Rect HoleRegion(HoleMin.x - PatchSize + 1, HoleMin.y - PatchSize + 1,
+			HoleMax.x - HoleMin.x + PatchSize, HoleMax.y - HoleMin.y + PatchSize);
+		HoleRegion &= Rect(0, 0, CurWork.cols, CurWork.rows);
+
+		if (nNNFLevel >= 0)
+		{
+			UpsampleNNF(ws.level(nNNFLevel).nnf, NNFRegion, NNF, HoleRegion, PatchSize, ws.rng);
+			bSeedNNF = true;
+		}
+		else if (bWarmNNF)
+		{
+			// the warm solve's own hole is unknown, so all of its NNF is taken;
+			// at the same size this is a copy of the offsets
+			const Mat & WarmNNF = WarmStart->nnf;
+			UpsampleNNF(WarmNNF, Rect(0, 0, WarmNNF.cols, WarmNNF.rows), NNF, HoleRegion, PatchSize, ws.rng);
+			bSeedNNF = true;
+		}
+
+		LevelSchedule Budget = options.schedule.level(nPyrmidNum, nLevels);
+		bool bExactNNF = LevelSize.area() <= options.schedule.exactNNFPixels;
+		int nIterMaxNum = Budget.maxIterations - nDoneIterations;
+
+		LevelReport Report;
+		Report.nLevel = nPyrmidNum;
+		Report.iterations = nDoneIterations;
+		Report.diff = 0;
+		Report.converged = bLevelSolved;
+		int64 nLevelStart = getTickCount();
+
+		auto writeCheckpoint = [&](bool bFinished) {
+			CheckpointState State;
+			State.imageSize = ImageSize;
+			State.imageType = nImageType;
+			State.halfPatchWidth = halfPatchWidth;
+			State.nLevels = nLevels;
+			State.level = nPyrmidNum;
+			State.iteration = Report.iterations;
+			State.anchorDiff = fAnchorDiff;
+			State.finished = bFinished;
+			State.rngState = ws.rng.state;
+			State.sourceHash = nSourceHash;
+			State.maskHash = nMaskHash;
+			State.work = CurWork;
+			State.nnf = NNF;
+			State.weight = Weight;
+			if (!SolverCheckpoint::write(options.checkpointPath, State))
+			{
+				printf("checkpoint: unable to write %s\n", options.checkpointPath.c_str());
+				ws.checkpointFailures++;
+			}
+			nLastCheckpoint = getTickCount();
+		};
+
+		// 循环直到本层收敛
+		while (!bLevelSolved)
+		{
+			if (cancelled(options))
+				return false;
+
+			CurWork.copyTo(LastImage);
+
+			if (video && video->isOpened() && nImageType == CV_8UC3)
+			{
+				resize(CurWork, ws.outputFrame, ImageSize);
+				*video << ws.outputFrame;
+			}
+
+			// patchMatch 计算各个patch的最近邻
+			// 之后的迭代都从上一次的NNF出发，只需少量传播
+			// 小图直接穷举出精确的最近邻
+			int nSweeps = bSeedNNF ? Budget.warmSweeps : Budget.coldSweeps;
+			bool bMatched = bExactNNF
+				? ExactNNF<T, cn>(CurWork, lvl.patchHoles, PatchSize, NNF, HoleRegion, lvl.exact, options.cancel)
+				: PatchMatch<T, cn>(CurWork, CurWork, lvl.patchHoles, PatchSize, NNF, ws.rng, HoleRegion, bSeedNNF, nSweeps, options.cancel);
+			if (!bMatched)
+				return false;
+			bSeedNNF = true;
+
+			// 循环图片
+			for (int i = HoleMin.y; i <= HoleMax.y; i++)
+			{
+				if (cancelled(options))
+					return false;
+
+				for (int j = HoleMin.x; j <= HoleMax.x; j++)
+				{
+					//需要填充的区域
+					if (CurMask.at<uchar>(i,j))
+					{
+
+						vector<float> & vecVoteColor = ws.voteColor;
+						vector<float> & vecVoteWeight = ws.voteWeight;
+						vector<float> & vecDist = ws.voteDist;
+						vecVoteColor.clear();
+						vecVoteWeight.clear();
+						vecDist.clear();
+
+						// 所有经过该点的patch块
+						for (int k = -PatchSize + 1; k <= 0; k++)
+						{
+							for (int m = -PatchSize + 1; m <= 0; m++)
+							{
+								int nPosY = i + k;
+								int nPosX = j + m;
+
+								// patch快还在图像范围内
+								if (nPosY < 0 
+									|| nPosX < 0
+									|| nPosX + PatchSize >= CurWork.cols -1
+									|| nPosY + PatchSize >= CurWork.rows - 1)
+									continue;
+
+								int NNF_X = NNF.at<NnfEntry>(nPosY, nPosX).x;
+								int NNF_Y = NNF.at<NnfEntry>(nPosY, nPosX).y;
+
+								// 两个patch之间的距离
+								int dist = (int)sqrt((double)PatchSSD<T, cn>(CurWork, nPosX, nPosY, CurWork, NNF_X, NNF_Y, PatchSize));
+
+								// 给某个颜色投票
+								const Pixel & VoteColor = CurWork.at<Pixel>(NNF_Y - k, NNF_X - m);
+
+								// 权重
+								float fWeight = Weight.at<float>(nPosY + PatchSize / 2, nPosX + PatchSize / 2);
+
+								vecDist.push_back((float)dist * dist);
+								for (int c = 0; c < cn; c++)
+									vecVoteColor.push_back(VoteColor[c]);
+								vecVoteWeight.push_back(fWeight);
+							}
+						}
+
+						if (vecVoteWeight.size() < 3)
+						{
+							continue;
+						}
+						// 复制一份
+						vector<float> & vecDistCopy = ws.voteDistSorted;
+						vecDistCopy.assign(vecDist.begin(), vecDist.end());//将v2赋值给v1
+
+						// only the 3/4 quantile is needed, no full sort
+						int nId = vecDistCopy.size() * 3 / 4;
+						nth_element(vecDistCopy.begin(), vecDistCopy.begin() + nId, vecDistCopy.end());
+						float nSigma = vecDistCopy[nId];
+
+						// 计算权重
+						for (int i =0 ; i < vecVoteWeight.size(); i++)
+						{
+							// 如果sigma不为0
+							if(nSigma != 0)
+								vecVoteWeight[i] = vecVoteWeight[i] * exp(-(vecDist[i]) / (2 * nSigma));
+						}
+
+						float nMax = 0;
+						for (int i = 0; i < vecVoteWeight.size(); i++)
+						{
+							if (nMax < vecVoteWeight[i])
+							{
+								nMax = vecVoteWeight[i];
+							}
+						}
+						// 归一化,避免权重过小
+						for (int i = 0; i < vecVoteWeight.size(); i++)
+						{
+							vecVoteWeight[i] = vecVoteWeight[i] / nMax;
+						}
+
+
+						CurWork.at<Pixel>(i,j)  = MeanShift<cn>(vecVoteColor, vecVoteWeight, 50 * fRangeScale);
+						
+					}
+				}
+			}
+			nIterMaxNum--;
+			Report.iterations++;
+
+			if (nIterMaxNum <= 0)
+			{
+				break;
+			}
+
+			float diff = 0;
+			int Num = 0;
+			for (int i = HoleMin.y; i <= HoleMax.y; i++)
+			{
+				for (int j = HoleMin.x; j <= HoleMax.x; j++)
+				{
+					if (CurMask.at<uchar>(i, j))
+					{
+						const Pixel & a1 = LastImage.at<Pixel>(i, j);
+						const Pixel & a2 = CurWork.at<Pixel>(i, j);
+						for (int c = 0; c < cn; c++)
+						{
+							float a3 = (float)a1[c] - a2[c];
+							diff += a3 * a3;
+						}
+
+						Num++;
+					}
+
+				}
+			}
+
+			// per hole pixel and channel in 8 bit units, comparable across
+			// levels and inputs
+			diff = diff / (Num * cn * fRangeScale * fRangeScale);
+			if (fAnchorDiff < 0 && Report.iterations == 2)
+				fAnchorDiff = diff;
+			Report.diff = diff;
+
+			if (video)
+			{
+				imshow("CurWork", CurWork);
+				cvWaitKey(100);
+
+				printf("scale: %f, dff: %f\n", scale, diff);
+			}
+		
+			if (diff < Budget.convergence || diff < Budget.relativeConvergence * fAnchorDiff)
+			{
+				Report.converged = true;
+				break;
+			}
+
+			// the level goes on: a resume from here runs the very next iteration
+			if (!options.checkpointPath.empty()
+				&& (getTickCount() - nLastCheckpoint) / getTickFrequency() >= options.checkpointSeconds)
+				writeCheckpoint(false);
+		}
+
+		// the finished solve, for warm starts of later runs with other parameters
+		if (nPyrmidNum == 0 && !bLevelSolved && !options.checkpointPath.empty())
+			writeCheckpoint(true);
+
+		Report.seconds = (getTickCount() - nLevelStart) / getTickFrequency();
+		ws.report.push_back(Report);
+
+		nNNFLevel = nPyrmidNum;
+		NNFRegion = HoleRegion;
+
+		// 向下一层，变大一倍
+		nPyrmidNum--;
+	}
+
+	const Mat & Solved = nLastLevel == 0 ? ws.level(0).work : pyramid.level(0);
+	if (bHoleOnly)
+		Solved.copyTo(result, mask);
+	else
+		Solved.copyTo(result);
+	return true;
+}
+
+static bool solveAnyHole(const SourcePyramid & pyramid, const Mat & mask, int halfPatchWidth,
+	const InpaintOptions & options, InpaintWorkspace & ws, Mat & result, VideoWriter * video, bool bHoleOnly)
+{
+	CV_Assert(pyramid.levelCount() >= 1);
+	if (!options.schedule.valid())
+		CV_Error(CV_StsBadArg, "inpaintHole: options.schedule has a tunable out of range");
+	// level 0 would be skipped like any level too small, and the hole left as it is
+	if (!Inpainter::patchFits(pyramid.level(0).size(), halfPatchWidth))
+		CV_Error(CV_StsBadSize, "inpaintHole: the smaller image side must be at least two patches");
+
+	switch (pyramid.level(0).type())
+	{
+	case CV_8UC1:
+		return solveHole<uchar, 1>(pyramid, mask, halfPatchWidth, options, ws, result, video, bHoleOnly);
+	case CV_8UC3:
+		return solveHole<uchar, 3>(pyramid, mask, halfPatchWidth, options, ws, result, video, bHoleOnly);
+	case CV_8UC4:
+		return solveHole<uchar, 4>(pyramid, mask, halfPatchWidth, options, ws, result, video, bHoleOnly);
+	case CV_16UC1:
+		return solveHole<ushort, 1>(pyramid, mask, halfPatchWidth, options, ws, result, video, bHoleOnly);
+	case CV_16UC3:
+		return solveHole<ushort, 3>(pyramid, mask, halfPatchWidth, options, ws, result, video, bHoleOnly);
+	case CV_16UC4:
+		return solveHole<ushort, 4>(pyramid, mask, halfPatchWidth, options, ws, result, video, bHoleOnly);
+	default:
+		CV_Error(CV_StsUnsupportedFormat, "inpaintHole: 8 or 16 bit images of 1, 3 or 4 channels only");
+	}
+	return false;
+}
+
+bool inpaintHole(const SourcePyramid & pyramid, const Mat & mask, int halfPatchWidth,
+	const InpaintOptions & options, InpaintWorkspace & ws, Mat & result, VideoWriter * video)
+{
+	return solveAnyHole(pyramid, mask, halfPatchWidth, options, ws, result, video, false);
+}
+
+bool inpaintHoleInto(const SourcePyramid & pyramid, const Mat & mask, int halfPatchWidth,
+	const InpaintOptions & options, InpaintWorkspace & ws, Mat & output)
+{
+	CV_Assert(output.size() == pyramid.level(0).size() && output.type() == pyramid.level(0).type());
+	return solveAnyHole(pyramid, mask, halfPatchWidth, options, ws, output, 0, true);
 }
\ No newline at end of file
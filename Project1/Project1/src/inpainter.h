@@ -45,6 +45,53 @@
 
 
 #include <opencv.hpp>
+#include "workspace.h"
+#include "sourcepyramid.h"
+#include "schedule.h"
+#include "checkpoint.h"
+#include "holeinit.h"
+#include "nnf.h"
+#include <atomic>
+#include <memory>
+#include <string>
+
+// Solver settings beyond the patch size.
+struct InpaintOptions
+{
+    InpaintOptions();
+
+    SchedulePolicy schedule;
+    HoleInit holeInit;              // fill of the coarsest hole, default noise
+
+    // CV_8UC1 of the image size or empty. Its non-zero pixels, e.g. objects
+    // other solves remove, are never a source, like the hole; only the hole
+    // itself is filled.
+    cv::Mat excludeFromSource;
+
+    // empty: no checkpoints; besides the periodic ones a final one is written
+    // when the solve completes, for warmStartFrom of later runs
+    std::string checkpointPath;
+    double checkpointSeconds;       // least time between two periodic checkpoints
+
+    // Continues a solve exactly where the checkpoint left it; ignored when it
+    // does not match (see SolverCheckpoint::matches).
+    SolverCheckpoint * resumeFrom;
+    // Seeds the hole, and the NNF when the patch size agrees, from an earlier
+    // solve of the same image run with other parameters, e.g. the final
+    // checkpoint of a finished one. The solve starts at the checkpoint's level
+    // when it has one that fine; the NNF is resampled to where it starts.
+    SolverCheckpoint * warmStartFrom;
+    // The solve copies what it uses of either checkpoint before it starts.
+    // With checkpointPath set it also closes them, so the path they were
+    // opened from can take the new checkpoints (Windows cannot replace a
+    // mapped file).
+
+    // Polled at every level, every EM iteration and every row of PatchMatch
+    // and voting; the solve gives up soon after it reads true.
+    const std::atomic<bool> * cancel;
+};
+
+class InpaintJob;
 
 class Inpainter
 {
@@ -57,6 +104,13 @@ public:
     const static int ERROR_MASK_INPUT_SIZE_MISMATCH=2;
     const static int ERROR_HALF_PATCH_WIDTH_ZERO=3;
     const static int CHECK_VALID=4;
+    const static int ERROR_CHECKPOINT_MISMATCH=5;
+    // checkpoints describe one solve; batches and videos run many
+    const static int ERROR_CHECKPOINT_UNSUPPORTED=7;
+    // the smaller image side is under two patches, see patchFits
+    const static int ERROR_IMAGE_TOO_SMALL=8;
+    // options.schedule has a tunable out of range, see SchedulePolicy::valid
+    const static int ERROR_INVALID_SCHEDULE=9;
 
     Inpainter(cv::Mat inputImage,cv::Mat mask,int halfPatchWidth=4,int mode=1);
 
@@ -68,14 +122,42 @@ public:
     cv::Mat targetRegion;
 
     int halfPatchWidth;
+    InpaintOptions options;
 
+    // 8 or 16 bit images with 1, 3 or 4 channels
+    static bool supportsType(int type);
+    // The solver skips every level whose smaller side is under two patches;
+    // level 0 itself must not be one of them.
+    static bool patchFits(cv::Size imageSize, int halfPatchWidth);
     int checkValidInputs();
+    // The checks of checkValidInputs for a solve not held by an Inpainter.
+    static int checkInputs(const cv::Mat & image, const cv::Mat & mask, int halfPatchWidth,
+        const InpaintOptions & options);
 
     void initializeMats();
     void inpaint(cv::VideoWriter & video);
+    void inpaint(cv::VideoWriter & video, InpaintWorkspace & workspace);
+    // Starts the solve on the shared pool and returns at once, see InpaintJob.
+    std::shared_ptr<InpaintJob> inpaintAsync() const;
 
 
 };
 
+// Fills the non-zero pixels of mask from the levels of pyramid, coarsest first,
+// and writes the completed full resolution image to result. The pyramid is only
+// read, so solves with their own workspaces may share it. Passing a video
+// writer turns on the debug output: frame dump, preview window and log.
+// Returns false, leaving result untouched, when options.cancel stopped it.
+bool inpaintHole(const SourcePyramid & pyramid, const cv::Mat & mask, int halfPatchWidth,
+    const InpaintOptions & options, InpaintWorkspace & workspace, cv::Mat & result,
+    cv::VideoWriter * video = 0);
+
+// As inpaintHole, but writes only the hole pixels of output and leaves every
+// other pixel alone. output must already have the image size and type; a
+// header over a caller's buffer is fine, and so is the buffer level 0 of the
+// pyramid borrows (see SourcePyramid::build), for an in-place solve.
+bool inpaintHoleInto(const SourcePyramid & pyramid, const cv::Mat & mask, int halfPatchWidth,
+    const InpaintOptions & options, InpaintWorkspace & workspace, cv::Mat & output);
+
 
 #endif // INPAINTER_H
@@ -0,0 +1,142 @@
+#include "inpaintjob.h"
+#include "threadpool.h"
+#include <chrono>
+
+using namespace cv;
+using namespace std;
+
+InpaintJob::InpaintJob()
+{
+	halfPatchWidth = 0;
+	cancelRequested = false;
+	state = QUEUED;
+}
+
+void InpaintJob::cancel()
+{
+	cancelRequested = true;
+}
+
+InpaintJob::Status InpaintJob::status() const
+{
+	lock_guard<mutex> lock(statusMutex);
+	return state;
+}
+
+bool InpaintJob::finished() const
+{
+	Status s = status();
+	return s != QUEUED && s != RUNNING;
+}
+
+bool InpaintJob::wait()
+{
+	unique_lock<mutex> lock(statusMutex);
+	statusChanged.wait(lock, [this]() { return state != QUEUED && state != RUNNING; });
+	return state == DONE;
+}
+
+bool InpaintJob::waitFor(double seconds)
+{
+	unique_lock<mutex> lock(statusMutex);
+	statusChanged.wait_for(lock, chrono::duration<double>(seconds),
+		[this]() { return state != QUEUED && state != RUNNING; });
+	return state == DONE;
+}
+
+void InpaintJob::finish(Status done)
+{
+	{
+		lock_guard<mutex> lock(statusMutex);
+		state = done;
+	}
+	statusChanged.notify_all();
+}
+
+void InpaintJob::run()
+{
+	// abandoned while still queued: costs nothing
+	if (cancelRequested)
+	{
+		finish(CANCELLED);
+		return;
+	}
+
+	{
+		lock_guard<mutex> lock(statusMutex);
+		state = RUNNING;
+	}
+
+	InpaintWorkspace & ws = threadWorkspace();
+
+	try
+	{
+		ws.pyramid.build(image, options.schedule.maxLevels);
+		bool bSolved = inpaintHole(ws.pyramid, mask, halfPatchWidth, options, ws, result);
+		report = ws.report;
+		finish(bSolved ? DONE : CANCELLED);
+	}
+	catch (const std::exception & e)
+	{
+		error = e.what();
+		finish(FAILED);
+	}
+	catch (...)
+	{
+		// the pool swallows anything else, which would leave the job RUNNING
+		error = "unknown exception";
+		finish(FAILED);
+	}
+}
+
+static const char * inputError(int nCheck)
+{
+	switch (nCheck)
+	{
+	case Inpainter::ERROR_INPUT_MAT_INVALID_TYPE:
+		return "unsupported image type";
+	case Inpainter::ERROR_INPUT_MASK_INVALID_TYPE:
+		return "mask is not CV_8UC1";
+	case Inpainter::ERROR_MASK_INPUT_SIZE_MISMATCH:
+		return "mask and image sizes differ";
+	case Inpainter::ERROR_HALF_PATCH_WIDTH_ZERO:
+		return "halfPatchWidth must be positive";
+	case Inpainter::ERROR_IMAGE_TOO_SMALL:
+		return "the smaller image side must be at least two patches";
+	case Inpainter::ERROR_INVALID_SCHEDULE:
+		return "schedule has a tunable out of range";
+	case Inpainter::ERROR_CHECKPOINT_MISMATCH:
+		return "checkpoint does not match the image and mask";
+	default:
+		return "invalid input";
+	}
+}
+
+shared_ptr<InpaintJob> inpaintAsync(const Mat & image, const Mat & mask, int halfPatchWidth,
+	const InpaintOptions & options)
+{
+	shared_ptr<InpaintJob> Job(new InpaintJob());
+
+	// a bad input fails here, on the caller's thread, and never reaches the pool
+	int nCheck = Inpainter::checkInputs(image, mask, halfPatchWidth, options);
+	if (nCheck != Inpainter::CHECK_VALID)
+	{
+		Job->error = inputError(nCheck);
+		Job->finish(InpaintJob::FAILED);
+		return Job;
+	}
+
+	Job->image = image.clone();
+	Job->mask = mask.clone();
+	Job->halfPatchWidth = halfPatchWidth;
+	Job->options = options;
+	Job->options.cancel = &Job->cancelRequested;
+
+	ThreadPool::shared().submit([Job]() { Job->run(); });
+	return Job;
+}
+
+shared_ptr<InpaintJob> Inpainter::inpaintAsync() const
+{
+	return ::inpaintAsync(inputImage, mask, halfPatchWidth, options);
+}
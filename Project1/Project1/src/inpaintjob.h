@@ -0,0 +1,68 @@
+#ifndef INPAINTJOB_H
+#define INPAINTJOB_H
+
+
+#include <opencv.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "inpainter.h"
+
+// Handle of one solve running on ThreadPool::shared(). The solve keeps its
+// own reference, so the handle may be dropped at any time; cancel() first if
+// the result is no longer wanted, or the cores stay busy until it finishes.
+class InpaintJob
+{
+public:
+    enum Status { QUEUED, RUNNING, DONE, CANCELLED, FAILED };
+
+    // A queued job never starts; a running one stops within a row of
+    // PatchMatch or voting.
+    void cancel();
+
+    Status status() const;
+    bool finished() const;
+
+    // Block until the job finished; true when it produced a result.
+    bool wait();
+    bool waitFor(double seconds);
+
+    // valid once the job is DONE
+    cv::Mat result;
+    std::vector<LevelReport> report;
+    std::string error;      // why a FAILED job failed: bad input or what() of its exception
+
+private:
+    InpaintJob();
+    InpaintJob(const InpaintJob &);
+    InpaintJob & operator=(const InpaintJob &);
+
+    void run();
+    void finish(Status done);
+
+    cv::Mat image;
+    cv::Mat mask;
+    int halfPatchWidth;
+    InpaintOptions options;
+
+    std::atomic<bool> cancelRequested;
+    mutable std::mutex statusMutex;
+    std::condition_variable statusChanged;
+    Status state;
+
+    friend std::shared_ptr<InpaintJob> inpaintAsync(const cv::Mat &, const cv::Mat &, int,
+        const InpaintOptions &);
+};
+
+// Queues a solve of image / mask on the shared pool and returns at once.
+// Both are copied, so the caller may reuse its buffers straight away. Inputs
+// Inpainter::checkInputs rejects give a job that is already FAILED.
+// options.cancel is replaced by the job's own flag.
+std::shared_ptr<InpaintJob> inpaintAsync(const cv::Mat & image, const cv::Mat & mask,
+    int halfPatchWidth, const InpaintOptions & options = InpaintOptions());
+
+
+#endif // INPAINTJOB_H
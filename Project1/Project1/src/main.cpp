@@ -41,6 +41,9 @@
 //M*/
 
 #include "inpainter.h"
+#include "videopipeline.h"
+#include "server.h"
+#include "sweep.h"
 
 cv::Mat image,originalImage,inpaintMask;
 cv::Point prevPt(-1,-1);
@@ -63,12 +66,174 @@ static void onMouse( int event, int x, int y, int flags, void* )
     }
 }
 
+static int runVideo(int argc, char *argv[])
+{
+    if(argc<5){
+        std::cout<<std::endl<<"usage : --video input.avi mask output.avi [halfPatchWidth]"<<std::endl;
+        return 0;
+    }
+
+    VideoPipeline pipeline(argv[2],argv[3],argv[4]);
+    if(argc>=6)
+    {
+        std::stringstream ss;
+        ss<<argv[5];
+        ss>>pipeline.halfPatchWidth;
+    }
+
+    if(!pipeline.run()){
+        std::cout<<std::endl<<"Error unable to open input, mask or output"<<std::endl;
+        return 0;
+    }
+
+    const VideoPipelineStats & st=pipeline.stats;
+    printf("frames: %d, %.2f s, %.2f fps\n", st.frames, st.seconds, st.fps);
+    printf("decode : busy %.2f s, stall %.2f s\n", st.decode.busySeconds, st.decode.stallSeconds);
+    printf("inpaint: busy %.2f s, stall %.2f s\n", st.inpaint.busySeconds, st.inpaint.stallSeconds);
+    printf("encode : busy %.2f s, stall %.2f s\n", st.encode.busySeconds, st.encode.stallSeconds);
+    return 0;
+}
+
+static int runServer(int argc, char *argv[])
+{
+    if(argc<3){
+        std::cout<<std::endl<<"usage : --serve socket [workers] [maxQueued]"<<std::endl;
+        return 0;
+    }
+
+    int workers=argc>=4 ? atoi(argv[3]) : 0;
+    int maxQueued=argc>=5 ? atoi(argv[4]) : 16;
+
+    InpaintServer server(argv[2],workers,maxQueued);
+    if(!server.run()){
+        std::cout<<std::endl<<"Error unable to listen on "<<argv[2]<<std::endl;
+    }
+    return 0;
+}
+
+static int runClient(int argc, char *argv[])
+{
+    if(argc<4){
+        std::cout<<std::endl<<"usage : --client socket request..."<<std::endl;
+        return 0;
+    }
 
+    std::string request=argv[3];
+    for(int n=4;n<argc;n++)
+        request+=std::string(" ")+argv[n];
+
+    std::string reply=sendInpaintRequest(argv[2],request);
+    if(reply.empty()){
+        std::cout<<std::endl<<"Error no reply from "<<argv[2]<<std::endl;
+        return 1;
+    }
+    std::cout<<reply<<std::endl;
+    return 0;
+}
+
+
+static int runSweep(int argc, char *argv[])
+{
+    //--sweep [testsDir] [report.csv] [hpw=2,3,4] [levels=3,6] [iters=10,30]
+    //        [init=noise,pushpull,onion,telea] [exact=0,4096]
+    std::string csvPath="sweep.csv";
+    std::vector<std::string> positional;
+    std::vector<std::string> inits,exacts;
+
+    QualitySweep sweep(".\\tests");
+    for(int n=2;n<argc;n++)
+    {
+        std::string arg=argv[n];
+        size_t eq=arg.find('=');
+        if(eq==std::string::npos){
+            positional.push_back(arg);
+            continue;
+        }
+
+        std::vector<std::string> items;
+        std::vector<int> values;
+        std::stringstream ss(arg.substr(eq+1));
+        std::string item;
+        while(std::getline(ss,item,',')){
+            items.push_back(item);
+            values.push_back(atoi(item.c_str()));
+        }
+
+        std::string key=arg.substr(0,eq);
+        if(key=="init")
+            inits=items;
+        else if(key=="exact")
+            exacts=items;
+        else if(key=="hpw")
+            sweep.halfPatchWidths=values;
+        else if(key=="levels")
+            sweep.maxLevels=values;
+        else if(key=="iters")
+            sweep.coarsestIterations=values;
+        else
+            std::cout<<"ignoring "<<arg<<std::endl;
+    }
+
+    //engines are the cross product of init= and exact=, in whichever order they came
+    if(!inits.empty()){
+        //one engine per hole initialization
+        sweep.engines.clear();
+        for(size_t n=0;n<inits.size();n++){
+            InpaintOptions engine;
+            if(parseHoleInit(inits[n],engine.holeInit))
+                sweep.engines.push_back(std::make_pair(inits[n],engine));
+            else
+                std::cout<<"ignoring init "<<inits[n]<<std::endl;
+        }
+    }
+    if(!exacts.empty()){
+        //every engine once per exact NNF threshold, 0 = PatchMatch only
+        std::vector<std::pair<std::string,InpaintOptions> > engines;
+        for(size_t e=0;e<sweep.engines.size();e++){
+            for(size_t n=0;n<exacts.size();n++){
+                InpaintOptions engine=sweep.engines[e].second;
+                engine.schedule.exactNNFPixels=atoi(exacts[n].c_str());
+                engines.push_back(std::make_pair(sweep.engines[e].first+"/exact"+exacts[n],engine));
+            }
+        }
+        sweep.engines=engines;
+    }
+    if(positional.size()>=1)
+        sweep.testsDir=positional[0];
+    if(positional.size()>=2)
+        csvPath=positional[1];
+
+    if(!sweep.run()){
+        std::cout<<std::endl<<"Error no test images in "<<sweep.testsDir<<std::endl;
+        return 1;
+    }
+
+    sweep.printReport();
+    if(!sweep.writeCsv(csvPath))
+        std::cout<<std::endl<<"Error unable to write "<<csvPath<<std::endl;
+    return 0;
+}
 
 
 int main(int argc, char *argv[])
 {
 
+    //with --video the arguments are the input clip, the mask (image or sequence),
+    //the output clip and optionally the halfPatchWidth.
+    if(argc>=2 && std::string(argv[1])=="--video")
+        return runVideo(argc,argv);
+
+    //--serve keeps a resident server on a local socket, --client sends it one request.
+    if(argc>=2 && std::string(argv[1])=="--serve")
+        return runServer(argc,argv);
+    if(argc>=2 && std::string(argv[1])=="--client")
+        return runClient(argc,argv);
+
+    //--sweep solves the bundled test images over a parameter grid and
+    //reports time, memory and hole quality of every setting.
+    if(argc>=2 && std::string(argv[1])=="--sweep")
+        return runSweep(argc,argv);
+
     //we expect three arguments.
     //the first is the image path.
     //the second is the mask path.
@@ -0,0 +1,22 @@
+#ifndef NNF_H
+#define NNF_H
+
+
+#include <opencv.hpp>
+
+// One entry of a nearest-neighbour field: the top-left corner of the best
+// source patch found so far and its SSD. Fields are NNF_TYPE Mats read as
+// NnfEntry, so the distance stays exact for 16 bit patches of any size.
+struct NnfEntry
+{
+    int x;
+    int y;
+    int64 dist;
+};
+
+const int NNF_TYPE = CV_32SC4;
+
+static_assert(sizeof(NnfEntry) == 16, "NnfEntry must match NNF_TYPE");
+
+
+#endif // NNF_H
@@ -0,0 +1,61 @@
+#include "schedule.h"
+#include "sourcepyramid.h"
+
+using namespace cv;
+using namespace std;
+
+SchedulePolicy::SchedulePolicy()
+{
+	maxLevels = 6;
+	holeToPatch = 2;
+	coarsestIterations = 30;
+	iterationDecay = 0.5f;
+	minIterations = 4;
+	convergence = 100 / 3.0f;
+	relativeConvergence = 0.02f;
+	coldSweeps = 5;
+	warmSweeps = 2;
+	finestWarmSweeps = 1;
+	// exact search costs a DFT of the level per hole patch and channel
+	exactNNFPixels = 64 * 64;
+}
+
+bool SchedulePolicy::valid() const
+{
+	return maxLevels >= 1 && holeToPatch > 0 && coarsestIterations >= 1 && iterationDecay > 0
+		&& minIterations >= 1 && convergence >= 0 && relativeConvergence >= 0
+		&& coldSweeps >= 1 && warmSweeps >= 1 && finestWarmSweeps >= 1 && exactNNFPixels >= 0;
+}
+
+int SchedulePolicy::levels(Size imageSize, float holeWidth, int patchSize) const
+{
+	int nLevels = 1;
+
+	// coarsen until a couple of patches bridge the hole, as long as the
+	// coarsest level still holds two patches across
+	while (nLevels < maxLevels && holeWidth / (1 << (nLevels - 1)) > holeToPatch * patchSize)
+	{
+		Size sz = SourcePyramid::levelSize(imageSize, nLevels);
+		if (min(sz.width, sz.height) < 2 * patchSize)
+			break;
+		nLevels++;
+	}
+	return nLevels;
+}
+
+LevelSchedule SchedulePolicy::level(int nLevel, int nLevels) const
+{
+	// finer levels cost four times as much per iteration but start from the
+	// upsampled solution of the coarser one, so they get fewer iterations
+	int nFromCoarsest = nLevels - 1 - nLevel;
+	float fBudget = coarsestIterations * pow(iterationDecay, (float)nFromCoarsest);
+
+	LevelSchedule s;
+	s.maxIterations = max(minIterations, cvRound(fBudget));
+	s.convergence = convergence;
+	s.relativeConvergence = relativeConvergence;
+	// an inherited NNF is already close, and level 0 is where sweeps cost most
+	s.coldSweeps = coldSweeps;
+	s.warmSweeps = nLevel == 0 ? finestWarmSweeps : warmSweeps;
+	return s;
+}
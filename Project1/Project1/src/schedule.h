@@ -0,0 +1,49 @@
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+
+#include <opencv.hpp>
+
+// Iteration budget and stopping rule of one pyramid level.
+struct LevelSchedule
+{
+    int maxIterations;
+    float convergence;          // stop below this mean squared change ...
+    float relativeConvergence;  // ... or below this fraction of the second iteration's change
+    int coldSweeps;             // PatchMatch sweeps from a random NNF
+    int warmSweeps;             // sweeps from the previous iteration's or level's NNF
+};
+
+// Picks the pyramid depth of a solve from the hole size and gives every level
+// an EM iteration budget. The fields are plain tunables so they can be fitted
+// against measured timings (see InpaintWorkspace::report).
+class SchedulePolicy
+{
+public:
+    SchedulePolicy();
+
+    int maxLevels;              // pyramid depth cap
+    float holeToPatch;          // coarsest level shrinks the hole to this many patch widths
+    int coarsestIterations;     // budget of the coarsest level
+    float iterationDecay;       // budget factor of each finer level
+    int minIterations;          // budget floor of the finest levels
+    float convergence;          // mean squared change per hole pixel and channel
+    float relativeConvergence;
+    int coldSweeps;             // PatchMatch sweeps from a random NNF
+    int warmSweeps;             // sweeps from an inherited NNF, coarser levels
+    int finestWarmSweeps;       // the same at the full resolution level
+    int exactNNFPixels;         // levels up to this area get an exact NNF, not PatchMatch
+
+    // false when a tunable is out of range: fewer than one level, iteration
+    // or sweep, or a negative factor or threshold
+    bool valid() const;
+
+    // holeWidth is the diameter of the largest disc that fits in the hole.
+    int levels(cv::Size imageSize, float holeWidth, int patchSize) const;
+
+    // nLevel counts from the full resolution level 0 up to nLevels - 1.
+    LevelSchedule level(int nLevel, int nLevels) const;
+};
+
+
+#endif // SCHEDULE_H
@@ -0,0 +1,664 @@
+#include "server.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <winsock2.h>
+#include <afunix.h>
+#include <windows.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using namespace cv;
+using namespace std;
+
+// A connection whose request line is still arriving.
+struct PendingRequest
+{
+	intptr_t client;
+	string line;
+	int64 deadline;     // getTickCount() at which an unfinished request is dropped
+};
+
+struct ServerJob
+{
+	intptr_t client;
+	map<string, string> params;
+	int64 enqueued;
+	atomic<bool> cancel;
+};
+
+#ifdef _WIN32
+static const intptr_t INVALID_CLIENT = (intptr_t)INVALID_SOCKET;
+
+static void initSockets()
+{
+	static once_flag Once;
+	call_once(Once, []() {
+		WSADATA Data;
+		WSAStartup(MAKEWORD(2, 2), &Data);
+	});
+}
+
+static void closeSocket(intptr_t s)
+{
+	closesocket((SOCKET)s);
+}
+#else
+static const intptr_t INVALID_CLIENT = -1;
+
+static void initSockets()
+{
+}
+
+static void closeSocket(intptr_t s)
+{
+	::close((int)s);
+}
+#endif
+
+static bool sendLine(intptr_t s, const string & line)
+{
+	string Data = line + "\n";
+	int flags = 0;
+#ifdef MSG_NOSIGNAL
+	// a client that hung up must not kill the daemon with SIGPIPE
+	flags = MSG_NOSIGNAL;
+#endif
+	size_t nSent = 0;
+	while (nSent < Data.size())
+	{
+		int n = send(s, Data.c_str() + nSent, (int)(Data.size() - nSent), flags);
+		if (n <= 0)
+			return false;
+		nSent += n;
+	}
+	return true;
+}
+
+static bool readLine(intptr_t s, string & line)
+{
+	line.clear();
+	char c;
+	while (line.size() < 4096)
+	{
+		if (recv(s, &c, 1, 0) != 1)
+			return false;
+		if (c == '\n')
+			return true;
+		if (c != '\r')
+			line += c;
+	}
+	return false;
+}
+
+static bool fillAddress(const string & path, sockaddr_un & addr)
+{
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(addr.sun_path))
+		return false;
+	strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+	return true;
+}
+
+#ifdef _WIN32
+typedef WSAPOLLFD PollEntry;
+
+static int pollSockets(vector<PollEntry> & entries, int nTimeoutMs)
+{
+	return WSAPoll(entries.data(), (ULONG)entries.size(), nTimeoutMs);
+}
+#else
+typedef pollfd PollEntry;
+
+static int pollSockets(vector<PollEntry> & entries, int nTimeoutMs)
+{
+	return poll(entries.data(), entries.size(), nTimeoutMs);
+}
+#endif
+
+static PollEntry readable(intptr_t s)
+{
+	PollEntry Entry;
+	memset(&Entry, 0, sizeof(Entry));
+#ifdef _WIN32
+	Entry.fd = (SOCKET)s;
+	Entry.events = POLLRDNORM;
+#else
+	Entry.fd = (int)s;
+	Entry.events = POLLIN;
+#endif
+	return Entry;
+}
+
+// The client sends nothing after its request line, so a readable socket
+// means it closed its end (or reset it).
+static bool peerClosed(intptr_t s)
+{
+#ifdef _WIN32
+	WSAPOLLFD Poll;
+	Poll.fd = (SOCKET)s;
+	Poll.events = POLLRDNORM;
+	Poll.revents = 0;
+	if (WSAPoll(&Poll, 1, 0) <= 0)
+		return false;
+#else
+	pollfd Poll;
+	Poll.fd = (int)s;
+	Poll.events = POLLIN;
+	Poll.revents = 0;
+	if (poll(&Poll, 1, 0) <= 0)
+		return false;
+#endif
+	if (Poll.revents & (POLLHUP | POLLERR))
+		return true;
+	char c;
+	return recv(s, &c, 1, MSG_PEEK) <= 0;
+}
+
+static int paramInt(const map<string, string> & params, const string & key, int nDefault)
+{
+	map<string, string>::const_iterator it = params.find(key);
+	return it == params.end() ? nDefault : atoi(it->second.c_str());
+}
+
+static string paramString(const map<string, string> & params, const string & key)
+{
+	map<string, string>::const_iterator it = params.find(key);
+	return it == params.end() ? string() : it->second;
+}
+
+// Named shared memory of another process, mapped read-write.
+class SharedBuffer
+{
+public:
+	SharedBuffer() : view(0), viewSize(0)
+	{
+#ifdef _WIN32
+		mapping = 0;
+#endif
+	}
+
+	~SharedBuffer()
+	{
+#ifdef _WIN32
+		if (view)
+			UnmapViewOfFile(view);
+		if (mapping)
+			CloseHandle(mapping);
+#else
+		if (view)
+			munmap(view, viewSize);
+#endif
+	}
+
+	bool open(const string & name, size_t nSize)
+	{
+#ifdef _WIN32
+		mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, name.c_str());
+		if (!mapping)
+			return false;
+		view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, nSize);
+#else
+		int fd = shm_open(name.c_str(), O_RDWR, 0);
+		if (fd < 0)
+			return false;
+
+		struct stat st;
+		if (fstat(fd, &st) == 0 && (size_t)st.st_size >= nSize)
+		{
+			void * p = mmap(0, nSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			if (p != MAP_FAILED)
+				view = p;
+		}
+		::close(fd);
+#endif
+		viewSize = nSize;
+		return view != 0;
+	}
+
+	uchar * data()
+	{
+		return (uchar *)view;
+	}
+
+private:
+	void * view;
+	size_t viewSize;
+#ifdef _WIN32
+	HANDLE mapping;
+#endif
+};
+
+InpaintServer::InpaintServer(const string & socketPath, int nWorkers, int maxQueued)
+	: jobs(max(1, maxQueued))
+{
+	this->socketPath = socketPath;
+	this->halfPatchWidth = 4;
+	// more solves at once than the shared pool has threads would only queue there
+	int nPoolThreads = ThreadPool::shared().size();
+	this->nWorkers = nWorkers > 0 ? min(nWorkers, nPoolThreads) : nPoolThreads;
+	this->maxQueued = max(1, maxQueued);
+	this->draining = 0;
+
+	memset(&counters, 0, sizeof(counters));
+	counters.workers = this->nWorkers;
+	counters.maxQueued = this->maxQueued;
+	totalWaitSeconds = 0;
+	totalSolveSeconds = 0;
+	stopping = false;
+	watching = false;
+}
+
+InpaintServer::~InpaintServer()
+{
+}
+
+ServerStats InpaintServer::stats()
+{
+	lock_guard<mutex> lock(statsMutex);
+	ServerStats s = counters;
+	s.queued = (int)jobs.size();
+	long nFinished = s.completed + s.failed + s.cancelled;
+	s.meanWaitSeconds = nFinished > 0 ? totalWaitSeconds / nFinished : 0;
+	s.meanSolveSeconds = nFinished > 0 ? totalSolveSeconds / nFinished : 0;
+	return s;
+}
+
+bool InpaintServer::run()
+{
+	initSockets();
+
+	sockaddr_un addr;
+	if (!fillAddress(socketPath, addr))
+		return false;
+
+	intptr_t listener = (intptr_t)socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listener == INVALID_CLIENT)
+		return false;
+
+	// a socket file left by an earlier run would make bind fail
+	remove(socketPath.c_str());
+	if (::bind(listener, (sockaddr *)&addr, sizeof(addr)) != 0 || listen(listener, 64) != 0)
+	{
+		closeSocket(listener);
+		return false;
+	}
+
+	watching = true;
+	thread Watcher(&InpaintServer::watchLoop, this);
+
+	// This thread accepts and collects the request lines of every open
+	// connection without blocking on any of them; only solves go to the pool.
+	// A client gets 5 s to send its line.
+	const int64 nRequestTicks = (int64)(5 * getTickFrequency());
+	vector<PendingRequest> Pending;
+	vector<PollEntry> Polled;
+	while (!stopping)
+	{
+		Polled.clear();
+		Polled.push_back(readable(listener));
+		for (size_t i = 0; i < Pending.size(); i++)
+			Polled.push_back(readable(Pending[i].client));
+
+		// wakes now and then to drop connections past their deadline
+		if (pollSockets(Polled, 100) < 0)
+			continue;
+
+		int64 nNow = getTickCount();
+		for (size_t i = Pending.size(); i-- > 0; )
+		{
+			bool bFinished;
+			if (Polled[i + 1].revents != 0)
+				bFinished = readRequest(Pending[i]);
+			else if (nNow > Pending[i].deadline)
+			{
+				closeSocket(Pending[i].client);
+				bFinished = true;
+			}
+			else
+				bFinished = false;
+
+			if (bFinished)
+				Pending.erase(Pending.begin() + i);
+		}
+
+		if (Polled[0].revents != 0)
+		{
+			intptr_t client = (intptr_t)accept(listener, 0, 0);
+			if (client != INVALID_CLIENT)
+			{
+				PendingRequest Request;
+				Request.client = client;
+				Request.deadline = nNow + nRequestTicks;
+				Pending.push_back(Request);
+			}
+		}
+	}
+	for (size_t i = 0; i < Pending.size(); i++)
+		closeSocket(Pending[i].client);
+
+	// queued jobs still get their answer
+	jobs.close();
+	{
+		unique_lock<mutex> lock(taskMutex);
+		taskFinished.wait(lock, [this]() { return draining == 0; });
+	}
+	watching = false;
+	Watcher.join();
+
+	closeSocket(listener);
+	remove(socketPath.c_str());
+	return true;
+}
+
+// Reads what arrived on a connection poll found readable. True once the
+// connection is dealt with: its request line was handled, or it closed or
+// sent too much without a line end.
+bool InpaintServer::readRequest(PendingRequest & request)
+{
+	char Buffer[512];
+	int n = recv(request.client, Buffer, sizeof(Buffer), 0);
+	if (n <= 0)
+	{
+		closeSocket(request.client);
+		return true;
+	}
+	request.line.append(Buffer, n);
+
+	size_t nEnd = request.line.find('\n');
+	if (nEnd == string::npos)
+	{
+		if (request.line.size() < 4096)
+			return false;
+		closeSocket(request.client);
+		return true;
+	}
+
+	string Line = request.line.substr(0, nEnd);
+	Line.erase(remove(Line.begin(), Line.end(), '\r'), Line.end());
+	handleRequest(request.client, Line);
+	return true;
+}
+
+void InpaintServer::handleRequest(intptr_t client, const string & line)
+{
+	stringstream ss(line);
+	string Command, Token;
+	ss >> Command;
+
+	if (Command == "STATS")
+	{
+		ServerStats s = stats();
+		char Reply[512];
+		snprintf(Reply, sizeof(Reply),
+			"STATS workers=%d maxQueued=%d queued=%d peakQueued=%d running=%d accepted=%ld rejected=%ld completed=%ld failed=%ld cancelled=%ld meanWaitSeconds=%.3f meanSolveSeconds=%.3f",
+			s.workers, s.maxQueued, s.queued, s.peakQueued, s.running, s.accepted, s.rejected,
+			s.completed, s.failed, s.cancelled, s.meanWaitSeconds, s.meanSolveSeconds);
+		sendLine(client, Reply);
+		closeSocket(client);
+		return;
+	}
+
+	if (Command == "SHUTDOWN")
+	{
+		stopping = true;
+		sendLine(client, "OK shutdown");
+		closeSocket(client);
+		return;
+	}
+
+	if (Command != "INPAINT")
+	{
+		sendLine(client, "ERR unknown command");
+		closeSocket(client);
+		return;
+	}
+
+	ServerJob * pJob = new ServerJob();
+	pJob->client = client;
+	while (ss >> Token)
+	{
+		size_t nEq = Token.find('=');
+		if (nEq != string::npos)
+			pJob->params[Token.substr(0, nEq)] = Token.substr(nEq + 1);
+	}
+	pJob->enqueued = getTickCount();
+	pJob->cancel = false;
+
+	// watched from before the push, a worker may finish it right away
+	{
+		lock_guard<mutex> lock(activeMutex);
+		active.insert(pJob);
+	}
+
+	// admission control: a full queue is answered at once instead of piling up
+	if (stopping || !jobs.tryPush(pJob))
+	{
+		{
+			lock_guard<mutex> lock(activeMutex);
+			active.erase(pJob);
+		}
+		{
+			lock_guard<mutex> lock(statsMutex);
+			counters.rejected++;
+		}
+		sendLine(client, "BUSY " + to_string(jobs.size()));
+		closeSocket(client);
+		delete pJob;
+		return;
+	}
+
+	{
+		lock_guard<mutex> lock(statsMutex);
+		counters.accepted++;
+		counters.peakQueued = max(counters.peakQueued, (int)jobs.size());
+	}
+	scheduleDrain();
+}
+
+// Called after every push: starts another drain task unless nWorkers already
+// run. A running one takes the new job before it gives up (see drainJobs).
+void InpaintServer::scheduleDrain()
+{
+	{
+		lock_guard<mutex> lock(taskMutex);
+		if (draining >= nWorkers)
+			return;
+		draining++;
+	}
+	ThreadPool::shared().submit([this]() { drainJobs(); });
+}
+
+void InpaintServer::drainJobs()
+{
+	// kept per pool thread like the workspace, so jobs of a familiar size
+	// do not allocate
+	InpaintWorkspace & ws = threadWorkspace();
+	static thread_local Mat Result;
+
+	while (true)
+	{
+		// the empty check and the exit are one step under taskMutex, so a job
+		// pushed meanwhile is either seen here or starts a new drain task
+		ServerJob * pJob;
+		{
+			lock_guard<mutex> lock(taskMutex);
+			if (!jobs.tryPop(pJob))
+			{
+				draining--;
+				taskFinished.notify_all();
+				return;
+			}
+		}
+
+		int64 nStart = getTickCount();
+		{
+			lock_guard<mutex> lock(statsMutex);
+			counters.running++;
+			totalWaitSeconds += (nStart - pJob->enqueued) / getTickFrequency();
+		}
+
+		string Reply;
+		try
+		{
+			// abandoned while queued: no solve at all
+			Reply = pJob->cancel ? string("ERR cancelled") : execute(*pJob, ws, Result);
+		}
+		catch (const std::exception & e)
+		{
+			// the protocol is one line per reply
+			Reply = string("ERR ") + e.what();
+			replace(Reply.begin(), Reply.end(), '\n', ' ');
+		}
+
+		double fSeconds = (getTickCount() - nStart) / getTickFrequency();
+		bool bOk = Reply.compare(0, 2, "OK") == 0;
+		bool bCancelled = pJob->cancel;
+		if (bOk)
+		{
+			char Seconds[32];
+			snprintf(Seconds, sizeof(Seconds), " %.3f", fSeconds);
+			Reply += Seconds;
+		}
+
+		{
+			lock_guard<mutex> lock(statsMutex);
+			counters.running--;
+			if (bOk)
+				counters.completed++;
+			else if (bCancelled)
+				counters.cancelled++;
+			else
+				counters.failed++;
+			totalSolveSeconds += fSeconds;
+		}
+
+		{
+			lock_guard<mutex> lock(activeMutex);
+			active.erase(pJob);
+		}
+
+		sendLine(pJob->client, Reply);
+		closeSocket(pJob->client);
+		delete pJob;
+	}
+}
+
+void InpaintServer::watchLoop()
+{
+	while (watching)
+	{
+		this_thread::sleep_for(chrono::milliseconds(100));
+
+		lock_guard<mutex> lock(activeMutex);
+		for (set<ServerJob *>::iterator it = active.begin(); it != active.end(); ++it)
+		{
+			if (!(*it)->cancel && peerClosed((*it)->client))
+				(*it)->cancel = true;
+		}
+	}
+}
+
+string InpaintServer::execute(const ServerJob & job, InpaintWorkspace & ws, Mat & result)
+{
+	int nHalfPatchWidth = paramInt(job.params, "halfPatchWidth", halfPatchWidth);
+	if (nHalfPatchWidth <= 0)
+		return "ERR invalid halfPatchWidth";
+
+	InpaintOptions Options = options;
+	Options.cancel = &job.cancel;
+	Options.schedule.maxLevels = paramInt(job.params, "maxLevels", Options.schedule.maxLevels);
+	Options.schedule.coarsestIterations = paramInt(job.params, "coarsestIterations", Options.schedule.coarsestIterations);
+	Options.schedule.exactNNFPixels = paramInt(job.params, "exactNNFPixels", Options.schedule.exactNNFPixels);
+	if (Options.schedule.maxLevels < 1)
+		return "ERR invalid maxLevels";
+	if (!Options.schedule.valid())
+		return "ERR invalid schedule";
+
+	string ShmName = paramString(job.params, "shm");
+	if (!ShmName.empty())
+	{
+		int nWidth = paramInt(job.params, "width", 0);
+		int nHeight = paramInt(job.params, "height", 0);
+		if (nWidth <= 0 || nHeight <= 0)
+			return "ERR invalid width or height";
+
+		SharedBuffer Buffer;
+		size_t nPixels = (size_t)nWidth * nHeight;
+		if (!Buffer.open(ShmName, nPixels * 4))
+			return "ERR unable to map shared memory";
+
+		// the caller's buffer is used in place, the result overwrites the image
+		Mat Image(nHeight, nWidth, CV_8UC3, Buffer.data());
+		Mat Mask(nHeight, nWidth, CV_8UC1, Buffer.data() + nPixels * 3);
+		if (!Inpainter::patchFits(Image.size(), nHalfPatchWidth))
+			return "ERR image smaller than two patches";
+
+		ws.pyramid.build(Image, Options.schedule.maxLevels);
+		if (!inpaintHole(ws.pyramid, Mask, nHalfPatchWidth, Options, ws, Image))
+			return "ERR cancelled";
+		return "OK shm=" + ShmName;
+	}
+
+	string ImagePath = paramString(job.params, "image");
+	string MaskPath = paramString(job.params, "mask");
+	string OutputPath = paramString(job.params, "output");
+	if (ImagePath.empty() || MaskPath.empty() || OutputPath.empty())
+		return "ERR image, mask and output are required";
+
+	Mat Image = imread(ImagePath, IMREAD_COLOR);
+	Mat Mask = imread(MaskPath, IMREAD_GRAYSCALE);
+	if (Image.empty() || Mask.empty())
+		return "ERR unable to read image or mask";
+	if (Image.size() != Mask.size())
+		return "ERR mask and image sizes differ";
+	if (!Inpainter::patchFits(Image.size(), nHalfPatchWidth))
+		return "ERR image smaller than two patches";
+
+	ws.pyramid.build(Image, Options.schedule.maxLevels);
+	if (!inpaintHole(ws.pyramid, Mask, nHalfPatchWidth, Options, ws, result))
+		return "ERR cancelled";
+
+	if (!imwrite(OutputPath, result))
+		return "ERR unable to write output";
+	return "OK " + OutputPath;
+}
+
+string sendInpaintRequest(const string & socketPath, const string & request)
+{
+	initSockets();
+
+	sockaddr_un addr;
+	if (!fillAddress(socketPath, addr))
+		return string();
+
+	intptr_t s = (intptr_t)socket(AF_UNIX, SOCK_STREAM, 0);
+	if (s == INVALID_CLIENT)
+		return string();
+
+	string Reply;
+	if (connect(s, (sockaddr *)&addr, sizeof(addr)) == 0 && sendLine(s, request))
+		readLine(s, Reply);
+
+	closeSocket(s);
+	return Reply;
+}
@@ -0,0 +1,107 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+
+#include <opencv.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <string>
+#include <stdint.h>
+#include "boundedqueue.h"
+#include "inpainter.h"
+
+struct ServerStats
+{
+    int workers;
+    int maxQueued;
+    int queued;             // jobs waiting for a worker right now
+    int peakQueued;
+    int running;
+    long accepted;
+    long rejected;          // turned away by admission control
+    long completed;
+    long failed;
+    long cancelled;         // client hung up before its reply
+    double meanWaitSeconds;     // queue time of the finished jobs
+    double meanSolveSeconds;
+};
+
+struct ServerJob;
+struct PendingRequest;
+
+// Resident inpaint service on a local (Unix domain) socket, so small jobs do
+// not pay for process start-up. The thread in run() does all the socket
+// reading, so admission, STATS and SHUTDOWN answer however busy the solves
+// are; jobs run on ThreadPool::shared(), at most nWorkers at a time, and each
+// pool thread keeps its workspace warm between jobs. One request per
+// connection, one text line each way:
+//
+//   INPAINT image=<path> mask=<path> output=<path> [halfPatchWidth=<n>]
+//           [maxLevels=<n>] [coarsestIterations=<n>] [exactNNFPixels=<n>]
+//   INPAINT shm=<name> width=<w> height=<h> [...]
+//       shared memory holding the BGR image rows followed by the mask rows;
+//       the result replaces the image in place
+//   STATS
+//   SHUTDOWN
+//
+// Replies are "OK <output> <seconds>", "BUSY <queued>" when the queue is full,
+// "STATS <key>=<value> ..." or "ERR <reason>". Paths must not contain spaces.
+// A client that hangs up before its reply cancels the request: it is dropped
+// if still queued, and a running solve stops within a row of work.
+class InpaintServer
+{
+public:
+    InpaintServer(const std::string & socketPath, int nWorkers=0, int maxQueued=16);
+    ~InpaintServer();
+
+    std::string socketPath;
+    int halfPatchWidth;         // defaults of requests that do not set them
+    InpaintOptions options;
+
+    // Serves until a SHUTDOWN request, then finishes the queued jobs.
+    // Returns false when the socket cannot be created.
+    bool run();
+
+    ServerStats stats();
+
+private:
+    InpaintServer(const InpaintServer &);
+    InpaintServer & operator=(const InpaintServer &);
+
+    void scheduleDrain();
+    void drainJobs();
+    void watchLoop();
+    bool readRequest(PendingRequest & request);
+    void handleRequest(intptr_t client, const std::string & line);
+    std::string execute(const ServerJob & job, InpaintWorkspace & ws, cv::Mat & result);
+
+    int nWorkers;
+    int maxQueued;
+    BoundedQueue<ServerJob *> jobs;
+
+    // drain tasks on the shared pool; one is always running or queued while
+    // jobs holds anything
+    std::mutex taskMutex;
+    std::condition_variable taskFinished;
+    int draining;
+
+    std::mutex statsMutex;
+    ServerStats counters;
+    double totalWaitSeconds;
+    double totalSolveSeconds;
+    std::atomic<bool> stopping;
+
+    // queued and running jobs, watched for clients that hung up
+    std::mutex activeMutex;
+    std::set<ServerJob *> active;
+    std::atomic<bool> watching;
+};
+
+// Client side: sends one request line and returns the reply line, or an
+// empty string when the server cannot be reached.
+std::string sendInpaintRequest(const std::string & socketPath, const std::string & request);
+
+
+#endif // SERVER_H
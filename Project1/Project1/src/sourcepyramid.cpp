@@ -0,0 +1,61 @@
+#include "sourcepyramid.h"
+
+using namespace cv;
+using namespace std;
+
+SourcePyramid::SourcePyramid()
+{
+	borrowed = false;
+}
+
+SourcePyramid::SourcePyramid(const Mat & image, int nLevels)
+{
+	borrowed = false;
+	build(image, nLevels);
+}
+
+Size SourcePyramid::levelSize(Size imageSize, int nLevel)
+{
+	float scale = 1.0 / (1 << nLevel);
+	return Size(imageSize.width * scale, scale * imageSize.height);
+}
+
+void SourcePyramid::build(const Mat & image, int nLevels, bool borrow)
+{
+	CV_Assert(nLevels >= 1);
+
+	// stop before a level would shrink below one pixel
+	while (nLevels > 1)
+	{
+		Size sz = levelSize(image.size(), nLevels - 1);
+		if (min(sz.width, sz.height) >= 1)
+			break;
+		nLevels--;
+	}
+
+	levels.resize(nLevels);
+
+	// never copy into a buffer a previous build borrowed
+	if (borrowed)
+		levels[0].release();
+	if (borrow)
+		levels[0] = image;
+	else
+		image.copyTo(levels[0]);
+	borrowed = borrow;
+
+	for (int n = 1; n < nLevels; n++)
+	{
+		resize(image, levels[n], levelSize(image.size(), n));
+	}
+}
+
+int SourcePyramid::levelCount() const
+{
+	return (int)levels.size();
+}
+
+const Mat & SourcePyramid::level(int nLevel) const
+{
+	return levels[nLevel];
+}
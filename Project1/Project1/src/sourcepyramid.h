@@ -0,0 +1,34 @@
+#ifndef SOURCEPYRAMID_H
+#define SOURCEPYRAMID_H
+
+
+#include <opencv.hpp>
+#include <vector>
+
+// The clean source image resized to every pyramid level; level 0 is the full
+// resolution. Once built it is only read, so any number of concurrent solves
+// on the same photo can share one instance.
+class SourcePyramid
+{
+public:
+    SourcePyramid();
+    SourcePyramid(const cv::Mat & image, int nLevels);
+
+    static cv::Size levelSize(cv::Size imageSize, int nLevel);
+
+    // Reuses the level buffers when image size and type are unchanged.
+    // With borrow, level 0 is a header over image instead of a copy, and
+    // image has to stay alive and unchanged while the pyramid is read.
+    // nLevels must be at least 1.
+    void build(const cv::Mat & image, int nLevels, bool borrow = false);
+
+    int levelCount() const;
+    const cv::Mat & level(int nLevel) const;
+
+private:
+    std::vector<cv::Mat> levels;
+    bool borrowed;      // level 0 belongs to the caller of build
+};
+
+
+#endif // SOURCEPYRAMID_H
@@ -0,0 +1,425 @@
+#include "sweep.h"
+#include <algorithm>
+#include <fstream>
+#include <stdio.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <string.h>
+#endif
+
+using namespace cv;
+using namespace std;
+
+// Windows cannot lower the high-water mark, so there the value is the peak of
+// the whole sweep so far; on Linux it is rewound before every solve.
+static void resetPeakResident()
+{
+#ifndef _WIN32
+	FILE * pFile = fopen("/proc/self/clear_refs", "w");
+	if (pFile)
+	{
+		fputs("5", pFile);
+		fclose(pFile);
+	}
+#endif
+}
+
+static size_t peakResidentBytes()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS Counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &Counters, sizeof(Counters)))
+		return Counters.PeakWorkingSetSize;
+	return 0;
+#else
+	size_t nBytes = 0;
+	FILE * pFile = fopen("/proc/self/status", "r");
+	if (!pFile)
+		return 0;
+
+	char szLine[256];
+	while (fgets(szLine, sizeof(szLine), pFile))
+	{
+		unsigned long nKb;
+		if (strncmp(szLine, "VmHWM:", 6) == 0 && sscanf(szLine + 6, "%lu", &nKb) == 1)
+		{
+			nBytes = (size_t)nKb * 1024;
+			break;
+		}
+	}
+	fclose(pFile);
+	return nBytes;
+#endif
+}
+
+double holePsnr(const Mat & a, const Mat & b, const Mat & mask)
+{
+	Mat Diff;
+	absdiff(a, b, Diff);
+	Diff.convertTo(Diff, CV_32F);
+	Diff = Diff.mul(Diff);
+
+	Scalar Mse = mean(Diff, mask);
+	double fMse = 0;
+	for (int c = 0; c < a.channels(); c++)
+		fMse += Mse[c];
+	fMse /= a.channels();
+
+	// identical holes would be infinite; cap like most tools do
+	if (fMse < 1e-10)
+		return 100;
+	return 10 * log10(255.0 * 255.0 / fMse);
+}
+
+// SSIM map of two single channel float images with the usual 11x11 gaussian
+// window and constants for 8 bit data.
+static Mat ssimMap(const Mat & a, const Mat & b)
+{
+	const double C1 = 6.5025, C2 = 58.5225;
+	const Size Window(11, 11);
+
+	Mat MuA, MuB, SigmaA, SigmaB, SigmaAB;
+	GaussianBlur(a, MuA, Window, 1.5);
+	GaussianBlur(b, MuB, Window, 1.5);
+	GaussianBlur(a.mul(a), SigmaA, Window, 1.5);
+	GaussianBlur(b.mul(b), SigmaB, Window, 1.5);
+	GaussianBlur(a.mul(b), SigmaAB, Window, 1.5);
+
+	Mat MuA2 = MuA.mul(MuA);
+	Mat MuB2 = MuB.mul(MuB);
+	Mat MuAB = MuA.mul(MuB);
+	SigmaA -= MuA2;
+	SigmaB -= MuB2;
+	SigmaAB -= MuAB;
+
+	Mat Num = (2 * MuAB + C1).mul(2 * SigmaAB + C2);
+	Mat Den = (MuA2 + MuB2 + C1).mul(SigmaA + SigmaB + C2);
+	Mat Map;
+	divide(Num, Den, Map);
+	return Map;
+}
+
+double holeSsim(const Mat & a, const Mat & b, const Mat & mask)
+{
+	Mat A, B;
+	a.convertTo(A, CV_32F);
+	b.convertTo(B, CV_32F);
+
+	vector<Mat> ChannelsA, ChannelsB;
+	split(A, ChannelsA);
+	split(B, ChannelsB);
+
+	double fSsim = 0;
+	for (size_t c = 0; c < ChannelsA.size(); c++)
+		fSsim += mean(ssimMap(ChannelsA[c], ChannelsB[c]), mask)[0];
+	return fSsim / ChannelsA.size();
+}
+
+// Places a disc of a sixth of the short side where it keeps clear of the
+// object the bundled mask marks; false when no candidate spot is clean.
+static bool cutSyntheticHole(const Mat & realMask, Mat & hole)
+{
+	int nRadius = min(realMask.cols, realMask.rows) / 12;
+	if (nRadius < 2)
+		return false;
+
+	Mat Keep;
+	dilate(realMask, Keep, getStructuringElement(MORPH_RECT, Size(2 * nRadius + 1, 2 * nRadius + 1)));
+
+	const float Spots[] = { 0.25f, 0.75f, 0.5f };
+	for (int fy = 0; fy < 3; fy++)
+	{
+		for (int fx = 0; fx < 3; fx++)
+		{
+			Point Center(cvRound(realMask.cols * Spots[fx]), cvRound(realMask.rows * Spots[fy]));
+			Rect Box(Center.x - nRadius, Center.y - nRadius, 2 * nRadius + 1, 2 * nRadius + 1);
+			if ((Box & Rect(0, 0, realMask.cols, realMask.rows)) != Box)
+				continue;
+			if (countNonZero(Keep(Box)) > 0)
+				continue;
+
+			hole = Mat::zeros(realMask.size(), CV_8UC1);
+			circle(hole, Center, nRadius, Scalar::all(255), -1);
+			return true;
+		}
+	}
+	return false;
+}
+
+QualitySweep::QualitySweep(const string & testsDir)
+{
+	this->testsDir = testsDir;
+
+	const int Patches[] = { 2, 3, 4 };
+	const int Levels[] = { 3, 6 };
+	const int Iterations[] = { 10, 30 };
+	halfPatchWidths.assign(Patches, Patches + 3);
+	maxLevels.assign(Levels, Levels + 2);
+	coarsestIterations.assign(Iterations, Iterations + 2);
+	engines.push_back(make_pair(string("default"), InpaintOptions()));
+}
+
+bool QualitySweep::load()
+{
+	cases.clear();
+
+	vector<string> ImageNames, MaskNames, ResultNames;
+	for (int n = 1; ; n++)
+	{
+		char szName[32];
+		sprintf(szName, "image%d.jpg", n);
+		if (imread(testsDir + "/" + szName, IMREAD_COLOR).empty())
+			break;
+		ImageNames.push_back(szName);
+		sprintf(szName, "mask%d.jpg", n);
+		MaskNames.push_back(szName);
+		sprintf(szName, "result%d.jpg", n);
+		ResultNames.push_back(szName);
+	}
+	ImageNames.push_back("man.png");
+	MaskNames.push_back("man-mask.png");
+	ResultNames.push_back("");
+
+	for (size_t n = 0; n < ImageNames.size(); n++)
+	{
+		Mat Image = imread(testsDir + "/" + ImageNames[n], IMREAD_COLOR);
+		Mat RealMask = imread(testsDir + "/" + MaskNames[n], IMREAD_GRAYSCALE);
+		if (Image.empty() || RealMask.empty() || RealMask.size() != Image.size())
+			continue;
+
+		// jpeg masks are not exactly binary
+		threshold(RealMask, RealMask, 127, 255, THRESH_BINARY);
+
+		SweepCase Synthetic;
+		if (cutSyntheticHole(RealMask, Synthetic.mask))
+		{
+			Synthetic.name = ImageNames[n] + " (cut)";
+			Synthetic.synthetic = true;
+			Synthetic.image = Image;
+			Synthetic.truth = Image;
+			cases.push_back(Synthetic);
+		}
+
+		Mat Result;
+		if (!ResultNames[n].empty())
+			Result = imread(testsDir + "/" + ResultNames[n], IMREAD_COLOR);
+		if (!Result.empty() && Result.size() == Image.size())
+		{
+			SweepCase Reference;
+			Reference.name = ImageNames[n];
+			Reference.synthetic = false;
+			Reference.image = Image;
+			Reference.mask = RealMask;
+			Reference.truth = Result;
+			cases.push_back(Reference);
+		}
+	}
+
+	configs.clear();
+	for (size_t e = 0; e < engines.size(); e++)
+	{
+		for (size_t p = 0; p < halfPatchWidths.size(); p++)
+		{
+			for (size_t l = 0; l < maxLevels.size(); l++)
+			{
+				for (size_t i = 0; i < coarsestIterations.size(); i++)
+				{
+					SweepConfig Config;
+					Config.halfPatchWidth = halfPatchWidths[p];
+					Config.engine = engines[e].first;
+					Config.options = engines[e].second;
+					Config.options.schedule.maxLevels = maxLevels[l];
+					Config.options.schedule.coarsestIterations = coarsestIterations[i];
+					configs.push_back(Config);
+				}
+			}
+		}
+	}
+
+	return !cases.empty();
+}
+
+bool QualitySweep::run()
+{
+	if (!load())
+		return false;
+
+	runs.clear();
+	for (size_t c = 0; c < configs.size(); c++)
+	{
+		const SweepConfig & Config = configs[c];
+		for (size_t k = 0; k < cases.size(); k++)
+		{
+			const SweepCase & Case = cases[k];
+			int nRun = (int)(c * cases.size() + k + 1), nRuns = (int)(configs.size() * cases.size());
+
+			SweepRun Run = SweepRun();
+			Run.nConfig = (int)c;
+			Run.nCase = (int)k;
+			Run.check = Inpainter::checkInputs(Case.image, Case.mask, Config.halfPatchWidth, Config.options);
+			if (Run.check != Inpainter::CHECK_VALID)
+			{
+				runs.push_back(Run);
+				printf("[%d/%d] hpw %d levels %d iters %d %s, %s: skipped, %s\n",
+					nRun, nRuns, Config.halfPatchWidth, Config.options.schedule.maxLevels,
+					Config.options.schedule.coarsestIterations, Config.engine.c_str(), Case.name.c_str(),
+					Run.check == Inpainter::ERROR_IMAGE_TOO_SMALL ? "patch too large for the image" : "invalid input");
+				continue;
+			}
+
+			InpaintWorkspace ws;
+			Mat Result;
+			resetPeakResident();
+
+			int64 nStart = getTickCount();
+			ws.pyramid.build(Case.image, Config.options.schedule.maxLevels);
+			inpaintHole(ws.pyramid, Case.mask, Config.halfPatchWidth, Config.options, ws, Result);
+
+			Run.seconds = (getTickCount() - nStart) / getTickFrequency();
+			Run.workspaceBytes = ws.bytes();
+			Run.peakBytes = peakResidentBytes();
+			Run.iterations = 0;
+			for (size_t n = 0; n < ws.report.size(); n++)
+				Run.iterations += ws.report[n].iterations;
+			Run.coarseIterations = ws.report.empty() ? 0 : ws.report[0].iterations;
+			Run.coarseSeconds = ws.report.empty() ? 0 : ws.report[0].seconds;
+			Run.psnr = holePsnr(Result, Case.truth, Case.mask);
+			Run.ssim = holeSsim(Result, Case.truth, Case.mask);
+			runs.push_back(Run);
+
+			printf("[%d/%d] hpw %d levels %d iters %d %s, %s: %.2f s, %.2f dB, ssim %.4f\n",
+				nRun, nRuns, Config.halfPatchWidth, Config.options.schedule.maxLevels,
+				Config.options.schedule.coarsestIterations, Config.engine.c_str(),
+				Case.name.c_str(), Run.seconds, Run.psnr, Run.ssim);
+		}
+	}
+
+	summary.assign(configs.size(), SweepSummary());
+	vector<int> nSynthetic(configs.size(), 0), nReference(configs.size(), 0);
+	for (size_t c = 0; c < configs.size(); c++)
+		summary[c].nConfig = (int)c;
+
+	for (size_t r = 0; r < runs.size(); r++)
+	{
+		const SweepRun & Run = runs[r];
+		if (Run.check != Inpainter::CHECK_VALID)
+			continue;
+
+		SweepSummary & Sum = summary[Run.nConfig];
+		Sum.solved++;
+		Sum.seconds += Run.seconds;
+		Sum.coarseIterations += Run.coarseIterations;
+		Sum.coarseSeconds += Run.coarseSeconds;
+		Sum.workspaceBytes = max(Sum.workspaceBytes, Run.workspaceBytes);
+		Sum.peakBytes = max(Sum.peakBytes, Run.peakBytes);
+		if (cases[Run.nCase].synthetic)
+		{
+			Sum.syntheticPsnr += Run.psnr;
+			Sum.syntheticSsim += Run.ssim;
+			nSynthetic[Run.nConfig]++;
+		}
+		else
+		{
+			Sum.referencePsnr += Run.psnr;
+			Sum.referenceSsim += Run.ssim;
+			nReference[Run.nConfig]++;
+		}
+	}
+
+	for (size_t c = 0; c < summary.size(); c++)
+	{
+		SweepSummary & Sum = summary[c];
+		if (Sum.solved)
+		{
+			Sum.seconds /= Sum.solved;
+			Sum.coarseIterations /= Sum.solved;
+			Sum.coarseSeconds /= Sum.solved;
+		}
+		if (nSynthetic[c])
+		{
+			Sum.syntheticPsnr /= nSynthetic[c];
+			Sum.syntheticSsim /= nSynthetic[c];
+		}
+		if (nReference[c])
+		{
+			Sum.referencePsnr /= nReference[c];
+			Sum.referenceSsim /= nReference[c];
+		}
+	}
+
+	// Pareto front over mean time, workspace size and SSIM against ground
+	// truth; the reference scores are reported but do not rank, since the
+	// stored results are just another solver's answer.
+	for (size_t i = 0; i < summary.size(); i++)
+	{
+		SweepSummary & A = summary[i];
+		A.pareto = A.solved > 0;
+		for (size_t j = 0; j < summary.size() && A.pareto; j++)
+		{
+			const SweepSummary & B = summary[j];
+			if (!B.solved)
+				continue;
+			bool bNoWorse = B.seconds <= A.seconds && B.workspaceBytes <= A.workspaceBytes
+				&& B.syntheticSsim >= A.syntheticSsim;
+			bool bBetter = B.seconds < A.seconds || B.workspaceBytes < A.workspaceBytes
+				|| B.syntheticSsim > A.syntheticSsim;
+			if (i != j && bNoWorse && bBetter)
+				A.pareto = false;
+		}
+	}
+
+	return true;
+}
+
+bool QualitySweep::writeCsv(const string & path) const
+{
+	ofstream File(path.c_str());
+	if (!File)
+		return false;
+
+	File << "case,synthetic,half_patch_width,max_levels,coarsest_iterations,engine,"
+		<< "seconds,workspace_bytes,peak_bytes,iterations,coarse_iterations,coarse_seconds,psnr,ssim,pareto,skipped\n";
+	for (size_t r = 0; r < runs.size(); r++)
+	{
+		const SweepRun & Run = runs[r];
+		const SweepConfig & Config = configs[Run.nConfig];
+		const SweepCase & Case = cases[Run.nCase];
+		File << Case.name << "," << (Case.synthetic ? 1 : 0) << ","
+			<< Config.halfPatchWidth << "," << Config.options.schedule.maxLevels << ","
+			<< Config.options.schedule.coarsestIterations << "," << Config.engine << ","
+			<< Run.seconds << "," << Run.workspaceBytes << "," << Run.peakBytes << ","
+			<< Run.iterations << "," << Run.coarseIterations << "," << Run.coarseSeconds << ","
+			<< Run.psnr << "," << Run.ssim << ","
+			<< (summary[Run.nConfig].pareto ? 1 : 0) << ","
+			<< (Run.check != Inpainter::CHECK_VALID ? 1 : 0) << "\n";
+	}
+	return true;
+}
+
+static bool fasterFirst(const SweepSummary & a, const SweepSummary & b)
+{
+	return a.seconds < b.seconds;
+}
+
+void QualitySweep::printReport() const
+{
+	vector<SweepSummary> Sorted = summary;
+	sort(Sorted.begin(), Sorted.end(), fasterFirst);
+
+	printf("\n  hpw levels iters engine       cases seconds  ws MB  peak MB  coarse it  coarse s  cut dB  cut ssim  ref dB  ref ssim\n");
+	for (size_t n = 0; n < Sorted.size(); n++)
+	{
+		const SweepSummary & Sum = Sorted[n];
+		const SweepConfig & Config = configs[Sum.nConfig];
+		printf("%c %3d %6d %5d %-12s %5d %7.3f %6.1f %8.1f %10.1f %9.3f %7.2f %9.4f %7.2f %9.4f\n",
+			Sum.pareto ? '*' : ' ', Config.halfPatchWidth, Config.options.schedule.maxLevels,
+			Config.options.schedule.coarsestIterations, Config.engine.c_str(), Sum.solved, Sum.seconds,
+			Sum.workspaceBytes / 1048576.0, Sum.peakBytes / 1048576.0,
+			Sum.coarseIterations, Sum.coarseSeconds, Sum.syntheticPsnr, Sum.syntheticSsim, Sum.referencePsnr, Sum.referenceSsim);
+	}
+	printf("* : Pareto front over seconds, workspace size and ssim on the cut holes\n");
+}
@@ -0,0 +1,103 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+
+#include <opencv.hpp>
+#include <string>
+#include <vector>
+#include "inpainter.h"
+
+// One image the sweep solves. Synthetic cases cut a hole out of a clean part
+// of the photo, so truth holds the real pixels; reference cases use the
+// bundled mask and compare against the stored result.
+struct SweepCase
+{
+    std::string name;
+    bool synthetic;
+    cv::Mat image;
+    cv::Mat mask;       // CV_8UC1, non-zero inside the hole
+    cv::Mat truth;      // what the hole should look like
+};
+
+// One point of the parameter grid.
+struct SweepConfig
+{
+    int halfPatchWidth;
+    std::string engine;     // name of the options variant
+    InpaintOptions options;
+};
+
+struct SweepRun
+{
+    int nConfig;
+    int nCase;
+    int check;              // Inpainter::checkInputs; the run is skipped unless CHECK_VALID
+    double seconds;
+    size_t workspaceBytes;  // buffers the solve held
+    size_t peakBytes;       // resident high-water mark of the process
+    int iterations;         // EM iterations summed over all levels
+    int coarseIterations;   // of the coarsest level solved, where holeInit matters
+    double coarseSeconds;
+    double psnr;            // inside the hole only
+    double ssim;
+};
+
+// Quality and cost of one config, averaged over all cases.
+struct SweepSummary
+{
+    int nConfig;
+    int solved;             // cases the averages are over, the others were skipped
+    double seconds;
+    size_t workspaceBytes;
+    size_t peakBytes;
+    double coarseIterations;
+    double coarseSeconds;
+    double syntheticPsnr;
+    double syntheticSsim;
+    double referencePsnr;
+    double referenceSsim;
+    bool pareto;            // no other config is faster, smaller and better at once;
+                            // never set for a config that solved no case
+};
+
+// Runs the solver over the cross product of the grid below and every test
+// case, and reports which configs are on the time / memory / quality Pareto
+// front. Every solve gets a fresh workspace, so memory is per config.
+class QualitySweep
+{
+public:
+    // testsDir holds imageN.jpg, maskN.jpg and, where present, resultN.jpg,
+    // plus man.png / man-mask.png.
+    explicit QualitySweep(const std::string & testsDir);
+
+    std::string testsDir;
+
+    // the grid; engines are named InpaintOptions variants whose schedule
+    // depth and iterations are overridden by the two lists below
+    std::vector<int> halfPatchWidths;
+    std::vector<int> maxLevels;
+    std::vector<int> coarsestIterations;
+    std::vector<std::pair<std::string, InpaintOptions> > engines;
+
+    std::vector<SweepCase> cases;
+    std::vector<SweepConfig> configs;
+    std::vector<SweepRun> runs;
+    std::vector<SweepSummary> summary;
+
+    // Loads the cases and expands the grid; false when no case loads.
+    bool load();
+    // load(), then one solve per config and case. Cases a config cannot
+    // solve, e.g. images too small for its patch, are skipped and recorded.
+    bool run();
+
+    // one line per run, for spreadsheets
+    bool writeCsv(const std::string & path) const;
+    void printReport() const;
+};
+
+// Peak signal to noise ratio and mean SSIM over the non-zero pixels of mask.
+double holePsnr(const cv::Mat & a, const cv::Mat & b, const cv::Mat & mask);
+double holeSsim(const cv::Mat & a, const cv::Mat & b, const cv::Mat & mask);
+
+
+#endif // SWEEP_H
@@ -0,0 +1,61 @@
+#include "threadpool.h"
+
+using namespace std;
+
+ThreadPool::ThreadPool(int nThreads)
+{
+	stopping = false;
+
+	if (nThreads <= 0)
+		nThreads = max(1, (int)thread::hardware_concurrency());
+
+	for (int i = 0; i < nThreads; i++)
+	{
+		workers.push_back(thread(&ThreadPool::workerLoop, this));
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		lock_guard<mutex> lock(queueMutex);
+		stopping = true;
+	}
+	queueChanged.notify_all();
+
+	for (size_t i = 0; i < workers.size(); i++)
+	{
+		workers[i].join();
+	}
+}
+
+ThreadPool & ThreadPool::shared()
+{
+	static ThreadPool Pool;
+	return Pool;
+}
+
+int ThreadPool::size() const
+{
+	return (int)workers.size();
+}
+
+void ThreadPool::workerLoop()
+{
+	while (true)
+	{
+		function<void()> task;
+		{
+			unique_lock<mutex> lock(queueMutex);
+			queueChanged.wait(lock, [this]() { return stopping || !tasks.empty(); });
+
+			// pending tasks are still run on shutdown so no future is left hanging
+			if (tasks.empty())
+				return;
+
+			task = move(tasks.front());
+			tasks.pop_front();
+		}
+		task();
+	}
+}
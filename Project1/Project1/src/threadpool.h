@@ -0,0 +1,54 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads draining a FIFO of tasks.
+class ThreadPool
+{
+public:
+    // nThreads <= 0 starts one worker per hardware thread.
+    explicit ThreadPool(int nThreads = 0);
+    ~ThreadPool();
+
+    int size() const;
+
+    // Process-wide pool with one worker per hardware thread, started on first
+    // use. Solves from every caller share it instead of each starting threads
+    // of their own; its tasks must never wait on other tasks of the pool.
+    static ThreadPool & shared();
+
+    template<typename F>
+    std::future<void> submit(F task)
+    {
+        std::shared_ptr<std::packaged_task<void()> > job =
+            std::make_shared<std::packaged_task<void()> >(task);
+        std::future<void> done = job->get_future();
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            tasks.push_back([job]() { (*job)(); });
+        }
+        queueChanged.notify_one();
+        return done;
+    }
+
+private:
+    void workerLoop();
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()> > tasks;
+    std::mutex queueMutex;
+    std::condition_variable queueChanged;
+    bool stopping;
+};
+
+
+#endif // THREADPOOL_H
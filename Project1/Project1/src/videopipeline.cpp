@@ -0,0 +1,222 @@
+#include "videopipeline.h"
+#include "boundedqueue.h"
+#include "threadpool.h"
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <future>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace cv;
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+static double secondsSince(Clock::time_point start)
+{
+	return chrono::duration<double>(Clock::now() - start).count();
+}
+
+static bool cancelled(const InpaintOptions & options)
+{
+	return options.cancel && options.cancel->load(std::memory_order_relaxed);
+}
+
+// One frame's worth of buffers, recycled from the writer back to the reader.
+struct FrameSlot
+{
+	int nIndex;
+	Mat frame;
+	Mat mask;
+	Mat result;
+};
+
+VideoPipeline::VideoPipeline(const string & inputPath, const string & maskPath,
+	const string & outputPath, int halfPatchWidth)
+{
+	this->inputPath = inputPath;
+	this->maskPath = maskPath;
+	this->outputPath = outputPath;
+	this->halfPatchWidth = halfPatchWidth;
+	this->nWorkers = 0;
+	this->maxFramesInFlight = 0;
+	this->stats = VideoPipelineStats();
+}
+
+bool VideoPipeline::run()
+{
+	stats = VideoPipelineStats();
+
+	// every frame would write the same file and resume from another's state
+	if (!options.checkpointPath.empty() || options.resumeFrom || options.warmStartFrom)
+		return false;
+	if (!options.schedule.valid())
+		return false;
+
+	VideoCapture Capture(inputPath);
+	if (!Capture.isOpened())
+		return false;
+
+	// a single image is a static mask, anything else a mask sequence
+	Mat StaticMask = imread(maskPath, 0);
+	VideoCapture MaskCapture;
+	if (StaticMask.empty() && !MaskCapture.open(maskPath))
+		return false;
+
+	double fps = Capture.get(CAP_PROP_FPS);
+	if (fps <= 0)
+		fps = 25.0;
+
+	// opened before any frame is decoded, so a bad output path costs no solves
+	Size FrameSize((int)Capture.get(CAP_PROP_FRAME_WIDTH), (int)Capture.get(CAP_PROP_FRAME_HEIGHT));
+	VideoWriter Output;
+	if (FrameSize.area() <= 0 || !Output.open(outputPath, CV_FOURCC('M', 'J', 'P', 'G'), fps, FrameSize))
+		return false;
+
+	int nPoolThreads = ThreadPool::shared().size();
+	int nThreads = nWorkers > 0 ? min(nWorkers, nPoolThreads) : nPoolThreads;
+	int nSlots = maxFramesInFlight > 0 ? maxFramesInFlight : 2 * nThreads + 2;
+
+	vector<FrameSlot> Slots(nSlots);
+	BoundedQueue<FrameSlot *> FreeSlots(nSlots);
+	BoundedQueue<FrameSlot *> Inpainted(nSlots);
+	for (int i = 0; i < nSlots; i++)
+		FreeSlots.push(&Slots[i]);
+
+	// one entry per solve handed to the pool, so at most nThreads run at once
+	BoundedQueue<int> Solving(nThreads);
+	mutex StatsMutex;
+
+	Clock::time_point Start = Clock::now();
+
+	// Inpaints one frame on a pool thread. Frames with a mismatched mask or a
+	// failed solve are passed through unfilled. Inpainted never blocks here:
+	// it holds as many frames as there are slots.
+	auto solveFrame = [&](FrameSlot * pSlot, Clock::time_point queued) {
+		InpaintWorkspace & ws = threadWorkspace();
+
+		Clock::time_point t = Clock::now();
+		double fQueued = chrono::duration<double>(t - queued).count();
+		bool bSolved = false;
+		try
+		{
+			if (pSlot->mask.size() == pSlot->frame.size())
+			{
+				ws.pyramid.build(pSlot->frame, options.schedule.maxLevels);
+				bSolved = inpaintHole(ws.pyramid, pSlot->mask, halfPatchWidth, options, ws, pSlot->result);
+			}
+		}
+		catch (const std::exception &)
+		{
+			bSolved = false;
+		}
+		if (!bSolved)
+		{
+			pSlot->frame.copyTo(pSlot->result);
+		}
+		{
+			lock_guard<mutex> lock(StatsMutex);
+			stats.inpaint.busySeconds += secondsSince(t);
+			stats.inpaint.stallSeconds += fQueued;
+		}
+
+		Inpainted.push(pSlot);
+		int nToken;
+		Solving.pop(nToken);
+	};
+
+	thread Reader([&]() {
+		Mat MaskFrame;
+		Mat LastMask = StaticMask;
+		// the reader closes Inpainted once every solve has returned, so no
+		// task is still inside a queue when run() leaves
+		deque<future<void> > Solves;
+		for (int n = 0; !cancelled(options); n++)
+		{
+			Clock::time_point t = Clock::now();
+			FrameSlot * pSlot;
+			if (!FreeSlots.pop(pSlot))
+				break;
+			stats.decode.stallSeconds += secondsSince(t);
+
+			t = Clock::now();
+			if (!Capture.read(pSlot->frame))
+				break;
+
+			if (MaskCapture.isOpened() && MaskCapture.read(MaskFrame))
+			{
+				if (MaskFrame.channels() > 1)
+					cvtColor(MaskFrame, MaskFrame, COLOR_BGR2GRAY);
+				// compressed mask videos are not exactly binary
+				threshold(MaskFrame, LastMask, 127, 255, THRESH_BINARY);
+			}
+			LastMask.copyTo(pSlot->mask);
+			pSlot->nIndex = n;
+			stats.decode.busySeconds += secondsSince(t);
+
+			// waits while nThreads frames are already being solved
+			t = Clock::now();
+			Solving.push(0);
+			stats.decode.stallSeconds += secondsSince(t);
+
+			while (!Solves.empty() && Solves.front().wait_for(chrono::seconds(0)) == future_status::ready)
+				Solves.pop_front();
+			Clock::time_point queued = Clock::now();
+			Solves.push_back(ThreadPool::shared().submit([&solveFrame, pSlot, queued]() { solveFrame(pSlot, queued); }));
+		}
+		for (size_t i = 0; i < Solves.size(); i++)
+			Solves[i].wait();
+		Inpainted.close();
+	});
+
+	thread Writer([&]() {
+		map<int, FrameSlot *> Pending;
+		int nNext = 0;
+		while (true)
+		{
+			Clock::time_point t = Clock::now();
+			FrameSlot * pSlot;
+			if (!Inpainted.pop(pSlot))
+				break;
+			stats.encode.stallSeconds += secondsSince(t);
+
+			// wakes a reader waiting for a slot; the solves still on the pool
+			// stop within a row and their frames are dropped
+			if (cancelled(options))
+			{
+				FreeSlots.close();
+				Inpainted.close();
+				break;
+			}
+
+			// workers finish out of order, hold frames until their turn
+			Pending[pSlot->nIndex] = pSlot;
+
+			t = Clock::now();
+			while (!Pending.empty() && Pending.begin()->first == nNext)
+			{
+				FrameSlot * pReady = Pending.begin()->second;
+				Pending.erase(Pending.begin());
+				Output << pReady->result;
+
+				nNext++;
+				FreeSlots.push(pReady);
+			}
+			stats.encode.busySeconds += secondsSince(t);
+		}
+		Output.release();
+		stats.frames = nNext;
+	});
+
+	// the reader only finishes once every frame left the pool
+	Reader.join();
+	Writer.join();
+
+	stats.seconds = secondsSince(Start);
+	stats.fps = stats.seconds > 0 ? stats.frames / stats.seconds : 0;
+
+	return !cancelled(options);
+}
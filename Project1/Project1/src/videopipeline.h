@@ -0,0 +1,58 @@
+#ifndef VIDEOPIPELINE_H
+#define VIDEOPIPELINE_H
+
+
+#include <opencv.hpp>
+#include <string>
+#include "inpainter.h"
+
+struct StageStats
+{
+    double busySeconds;     // time spent doing the stage's own work
+    double stallSeconds;    // time spent blocked on a neighbouring queue
+};
+
+struct VideoPipelineStats
+{
+    int frames;
+    double seconds;
+    double fps;
+    StageStats decode;
+    StageStats inpaint;     // summed over all frames; stall is time queued on the pool
+    StageStats encode;
+};
+
+// Streams a clip through decode -> inpaint -> encode. A reader thread decodes
+// frames and their masks, ThreadPool::shared() inpaints them, and a writer
+// thread encodes them in the original order. The stages only exchange a fixed set of
+// frame slots through bounded queues, so at most maxFramesInFlight frames are
+// ever held in memory however long the clip is.
+class VideoPipeline
+{
+public:
+    // maskPath is a single mask image used for every frame, or anything
+    // cv::VideoCapture opens (a mask video or a pattern like mask_%04d.png);
+    // when the mask sequence ends early its last mask is kept.
+    VideoPipeline(const std::string & inputPath, const std::string & maskPath,
+        const std::string & outputPath, int halfPatchWidth=4);
+
+    std::string inputPath;
+    std::string maskPath;
+    std::string outputPath;
+
+    int halfPatchWidth;
+    InpaintOptions options;
+    int nWorkers;               // solves at once, <= 0 : one per shared pool thread
+    int maxFramesInFlight;      // <= 0 : two per worker plus one per queue end
+
+    VideoPipelineStats stats;
+
+    // Returns false when the input, the mask or the output cannot be opened,
+    // when options asks for checkpoints, which describe a single solve, when
+    // options.schedule is not valid, or when options.cancel stopped the clip;
+    // the frames encoded until then stay in the output.
+    bool run();
+};
+
+
+#endif // VIDEOPIPELINE_H
@@ -0,0 +1,111 @@
+#include "workspace.h"
+
+using namespace cv;
+using namespace std;
+
+InpaintWorkspace::InpaintWorkspace() : checkpointFailures(0)
+{
+}
+
+InpaintWorkspace & threadWorkspace()
+{
+	static thread_local InpaintWorkspace Workspace;
+	return Workspace;
+}
+
+static void prepareExact(ExactNNFBuffers & exact, Size sz, int cn)
+{
+	Size DftSize(getOptimalDFTSize(sz.width), getOptimalDFTSize(sz.height));
+	exact.image64.create(sz, CV_64FC(cn));
+	exact.planes.resize(cn);
+	exact.spectra.resize(cn);
+	for (int c = 0; c < cn; c++)
+	{
+		exact.planes[c].create(sz, CV_64F);
+		exact.spectra[c].create(DftSize, CV_64F);
+	}
+	exact.padded.create(DftSize, CV_64F);
+	exact.energy.create(sz, CV_64F);
+	exact.kernel.create(DftSize, CV_64F);
+	exact.kernelSpectrum.create(DftSize, CV_64F);
+	exact.product.create(DftSize, CV_64F);
+	exact.sum.create(DftSize, CV_64F);
+	exact.correlation.create(DftSize, CV_64F);
+}
+
+void InpaintWorkspace::prepare(Size imageSize, int imageType, int nLevels, int patchSize, int exactNNFPixels)
+{
+	// Mat::create is a no-op when size and type already match
+	weight.create(imageSize, CV_32F);
+	outputFrame.create(imageSize, imageType);
+
+	if ((int)levels.size() < nLevels)
+		levels.resize(nLevels);
+
+	for (int n = 0; n < nLevels; n++)
+	{
+		Size sz = SourcePyramid::levelSize(imageSize, n);
+		LevelBuffers & lvl = levels[n];
+		lvl.work.create(sz, imageType);
+		lvl.last.create(sz, imageType);
+		lvl.mask.create(sz, CV_8UC1);
+		lvl.weight.create(sz, CV_32F);
+		lvl.nnf.create(sz, NNF_TYPE);
+		lvl.excluded.create(sz, CV_8UC1);
+		lvl.patchHoles.create(sz, CV_32S);
+
+		// a level that grew past the limit since an earlier solve drops its scratch
+		if (sz.area() <= exactNNFPixels)
+			prepareExact(lvl.exact, sz, CV_MAT_CN(imageType));
+		else
+			lvl.exact = ExactNNFBuffers();
+	}
+
+	size_t nVotes = patchSize * patchSize;
+	voteColor.reserve(nVotes * CV_MAT_CN(imageType));
+	voteWeight.reserve(nVotes);
+	voteDist.reserve(nVotes);
+	voteDistSorted.reserve(nVotes);
+
+	report.reserve(nLevels);
+}
+
+LevelBuffers & InpaintWorkspace::level(int nLevel)
+{
+	return levels[nLevel];
+}
+
+static size_t matBytes(const Mat & m)
+{
+	return m.total() * m.elemSize();
+}
+
+static size_t exactBytes(const ExactNNFBuffers & exact)
+{
+	size_t nBytes = matBytes(exact.image64) + matBytes(exact.padded) + matBytes(exact.energy)
+		+ matBytes(exact.kernel) + matBytes(exact.kernelSpectrum) + matBytes(exact.product)
+		+ matBytes(exact.sum) + matBytes(exact.correlation);
+	for (size_t c = 0; c < exact.planes.size(); c++)
+		nBytes += matBytes(exact.planes[c]);
+	for (size_t c = 0; c < exact.spectra.size(); c++)
+		nBytes += matBytes(exact.spectra[c]);
+	return nBytes;
+}
+
+size_t InpaintWorkspace::bytes() const
+{
+	size_t nBytes = matBytes(weight) + matBytes(outputFrame);
+	for (int n = 0; n < pyramid.levelCount(); n++)
+		nBytes += matBytes(pyramid.level(n));
+
+	for (size_t n = 0; n < levels.size(); n++)
+	{
+		const LevelBuffers & lvl = levels[n];
+		nBytes += matBytes(lvl.work) + matBytes(lvl.last) + matBytes(lvl.mask)
+			+ matBytes(lvl.weight) + matBytes(lvl.nnf) + matBytes(lvl.excluded)
+			+ matBytes(lvl.patchHoles) + exactBytes(lvl.exact);
+	}
+
+	nBytes += (voteColor.capacity() + voteWeight.capacity() + voteDist.capacity() + voteDistSorted.capacity()) * sizeof(float);
+	return nBytes;
+}
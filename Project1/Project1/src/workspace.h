@@ -0,0 +1,97 @@
+#ifndef WORKSPACE_H
+#define WORKSPACE_H
+
+
+#include <opencv.hpp>
+#include <vector>
+#include "sourcepyramid.h"
+#include "nnf.h"
+
+// Scratch of ExactNNF on one level; everything CV_64F. The DFT buffers are
+// padded to getOptimalDFTSize of the level.
+struct ExactNNFBuffers
+{
+    cv::Mat image64;                    // the level, CV_64FC(cn)
+    std::vector<cv::Mat> planes;        // its channels
+    std::vector<cv::Mat> spectra;       // DFT of each padded channel
+    cv::Mat padded;
+    cv::Mat energy;                     // sum of squares under the patch at each corner
+    cv::Mat kernel;                     // one patch channel in the top-left block
+    cv::Mat kernelSpectrum;
+    cv::Mat product;
+    cv::Mat sum;
+    cv::Mat correlation;
+};
+
+// Scratch buffers of one pyramid level.
+struct LevelBuffers
+{
+    cv::Mat work;       // current estimate of the level
+    cv::Mat last;       // estimate of the previous EM iteration
+    cv::Mat mask;
+    cv::Mat weight;
+    cv::Mat nnf;        // NNF_TYPE, see NnfEntry
+    cv::Mat excluded;   // hole plus InpaintOptions::excludeFromSource, 0/255
+    cv::Mat patchHoles; // CV_32S : sum of the 0/255 excluded mask under the patch at each corner
+    ExactNNFBuffers exact;  // only sized on levels ExactNNF solves
+};
+
+// How one pyramid level of the last solve went.
+struct LevelReport
+{
+    int nLevel;
+    int iterations;
+    double seconds;
+    float diff;         // last mean squared change per hole pixel and channel
+    bool converged;     // false when the iteration budget ran out first
+};
+
+// Owns every per-level and per-pixel buffer of a solve. prepare() sizes the
+// buffers once per level; the EM loop then only reuses them, and a workspace
+// handed to consecutive solves of the same size never touches the heap again.
+// A workspace must not be shared by two solves running at the same time.
+class InpaintWorkspace
+{
+public:
+    InpaintWorkspace();
+
+    // exactNNFPixels: levels of at most that many pixels get ExactNNF scratch,
+    // see SchedulePolicy::exactNNFPixels
+    void prepare(cv::Size imageSize, int imageType, int nLevels, int patchSize, int exactNNFPixels);
+
+    LevelBuffers & level(int nLevel);
+
+    // bytes held by every buffer of the workspace
+    size_t bytes() const;
+
+    cv::Mat weight;         // full resolution distance weights
+    cv::Mat outputFrame;    // full resolution frame for the video dump
+
+    // pyramid of a single-image solve; batch solves share theirs instead
+    SourcePyramid pyramid;
+
+    // per-pixel voting scratch, capacity PatchSize * PatchSize votes;
+    // voteColor holds one float per channel of every vote
+    std::vector<float> voteColor;
+    std::vector<float> voteWeight;
+    std::vector<float> voteDist;
+    std::vector<float> voteDistSorted;
+
+    cv::RNG rng;
+
+    // filled by every solve, coarsest level first
+    std::vector<LevelReport> report;
+    // checkpoint writes of the last solve that failed
+    int checkpointFailures;
+
+private:
+    std::vector<LevelBuffers> levels;
+};
+
+// The workspace of the calling thread, kept until the thread exits. Every
+// solve run on a pool thread (jobs, video frames, server requests) takes
+// this one, so a thread holds a single warm workspace whatever it solves.
+InpaintWorkspace & threadWorkspace();
+
+
+#endif // WORKSPACE_H